@@ -0,0 +1,54 @@
+#version 450
+
+#include "helpers.glsl"
+
+layout(location = 0) in vec3 i_position;
+layout(location = 0) out vec4 o_color;
+layout(set = 3, binding = 0) uniform t_player_position
+{
+    vec3 u_player_position;
+};
+
+float get_random(
+    const vec2 position)
+{
+    return fract(sin(dot(position, vec2(127.1, 311.7))) * 43758.5453);
+}
+
+float get_noise(
+    const vec2 position)
+{
+    const vec2 cell = floor(position);
+    const vec2 t = smoothstep(0.0, 1.0, position - cell);
+    const float a = get_random(cell);
+    const float b = get_random(cell + vec2(1, 0));
+    const float c = get_random(cell + vec2(0, 1));
+    const float d = get_random(cell + vec2(1, 1));
+    return mix(mix(a, b, t.x), mix(c, d, t.x), t.y) * 2.0 - 1.0;
+}
+
+float get_cloud(
+    vec2 position)
+{
+    float cloud = 0.0;
+    float amplitude = 1.0;
+    for (int i = 0; i < CLOUD_OCTAVES; i++)
+    {
+        cloud += abs(get_noise(position)) * amplitude;
+        position *= 2.0;
+        amplitude *= 0.5;
+    }
+    return cloud;
+}
+
+void main()
+{
+    const float cloud = get_cloud(floor(i_position.xz) * CLOUD_SCALE);
+    if (cloud < 0.6)
+    {
+        discard;
+    }
+    const float fog = get_fog(distance(i_position.xz, u_player_position.xz));
+    const float alpha = mix(0.6, 0.9, smoothstep(0.6, 0.9, cloud));
+    o_color = vec4(1.0, 1.0, 1.0, alpha * (1.0 - fog));
+}
@@ -0,0 +1,21 @@
+#version 450
+
+#include "helpers.glsl"
+
+layout(location = 0) out vec3 o_position;
+layout(set = 1, binding = 0) uniform t_matrix
+{
+    mat4 u_matrix;
+};
+layout(set = 1, binding = 1) uniform t_player_position
+{
+    vec3 u_player_position;
+};
+
+void main()
+{
+    const vec3 corner = positions[4][indices[gl_VertexIndex]] * 2.0 - 1.0;
+    o_position = vec3(u_player_position.x, CLOUD_Y, u_player_position.z);
+    o_position.xz += corner.xz * CLOUD_EXTENT;
+    gl_Position = u_matrix * vec4(o_position, 1.0);
+}
@@ -9,7 +9,9 @@ layout(set = 2, binding = 1) uniform sampler2D s_position;
 layout(set = 2, binding = 2) uniform sampler2D s_uv;
 layout(set = 2, binding = 3) uniform usampler2D s_voxel;
 layout(set = 2, binding = 4) uniform sampler2D s_shadowmap;
+#if !VOXEL_AO
 layout(set = 2, binding = 5) uniform sampler2D s_ssao;
+#endif
 layout(set = 3, binding = 0) uniform t_player_position
 {
     vec3 u_player_position;
@@ -25,25 +27,29 @@ layout(set = 3, binding = 2) uniform t_shadow_matrix
 
 void main()
 {
-    const vec3 position = texture(s_position, i_uv).xyz;
+    const vec4 position = texture(s_position, i_uv);
     const vec2 uv = texture(s_uv, i_uv).xy;
     const uint voxel = texture(s_voxel, i_uv).x;
     if (length(uv) == 0)
     {
         discard;
     }
-    const vec4 shadow_position = u_shadow_matrix * vec4(position, 1.0);
+    const vec4 shadow_position = u_shadow_matrix * vec4(position.xyz, 1.0);
+#if VOXEL_AO
+    const float ao = position.w;
+#else
+    const float ao = texture(s_ssao, i_uv).r;
+#endif
     o_color = get_color(
-        s_atlas,
+        texture(s_atlas, uv),
         s_shadowmap,
-        position,
-        uv,
+        position.xyz,
         get_normal(voxel),
         u_player_position,
         shadow_position.xyz / shadow_position.w,
         u_shadow_vector,
         get_shadowed(voxel),
         get_fog(distance(position.xz, u_player_position.xz)),
-        texture(s_ssao, i_uv).r,
+        ao,
         0.0);
 }
\ No newline at end of file
@@ -3,22 +3,35 @@
 
 #include "config.h"
 
-const vec3 normals[6] = vec3[6]
+const vec3 normals[7] = vec3[7]
 (
     vec3( 0, 0, 1 ),
     vec3( 0, 0,-1 ),
     vec3( 1, 0, 0 ),
     vec3(-1, 0, 0 ),
     vec3( 0, 1, 0 ),
-    vec3( 0,-1, 0 )
+    vec3( 0,-1, 0 ),
+    vec3( 0, 1, 0 )
 );
 
-vec3 get_position(
-    const uint voxel)
-{
-    return vec3(voxel >> VOXEL_X_OFFSET & VOXEL_X_MASK,
-        voxel >> VOXEL_Y_OFFSET & VOXEL_Y_MASK, voxel >> VOXEL_Z_OFFSET & VOXEL_Z_MASK);
-}
+const int indices[6] = int[6](0, 1, 2, 3, 2, 1);
+const int flips[6] = int[6](0, 1, 3, 3, 2, 0);
+
+const vec3 positions[6][4] = vec3[6][4]
+(
+    vec3[4](vec3(0, 0, 1), vec3(0, 1, 1), vec3(1, 0, 1), vec3(1, 1, 1)),
+    vec3[4](vec3(0, 0, 0), vec3(1, 0, 0), vec3(0, 1, 0), vec3(1, 1, 0)),
+    vec3[4](vec3(1, 0, 0), vec3(1, 0, 1), vec3(1, 1, 0), vec3(1, 1, 1)),
+    vec3[4](vec3(0, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1), vec3(0, 1, 1)),
+    vec3[4](vec3(0, 1, 0), vec3(1, 1, 0), vec3(0, 1, 1), vec3(1, 1, 1)),
+    vec3[4](vec3(0, 0, 0), vec3(0, 0, 1), vec3(1, 0, 0), vec3(1, 0, 1))
+);
+
+const vec3 diagonals[2][4] = vec3[2][4]
+(
+    vec3[4](vec3(0, 0, 0), vec3(0, 1, 0), vec3(1, 0, 1), vec3(1, 1, 1)),
+    vec3[4](vec3(0, 0, 1), vec3(1, 0, 0), vec3(0, 1, 1), vec3(1, 1, 0))
+);
 
 vec2 get_atlas(
     const vec2 position)
@@ -27,11 +40,10 @@ vec2 get_atlas(
         position.y / ATLAS_HEIGHT * ATLAS_FACE_HEIGHT);
 }
 
-vec2 get_uv(
-    const uint voxel)
+vec3 get_origin(
+    const ivec2 page)
 {
-    return get_atlas(vec2(voxel >> VOXEL_U_OFFSET & VOXEL_U_MASK,
-        voxel >> VOXEL_V_OFFSET & VOXEL_V_MASK));
+    return vec3(page.x, 0.0, page.y);
 }
 
 uint get_direction(
@@ -40,12 +52,82 @@ uint get_direction(
     return voxel >> VOXEL_DIRECTION_OFFSET & VOXEL_DIRECTION_MASK;
 }
 
+float get_ao(
+    const uvec2 face,
+    const int corner)
+{
+    return float(face.y >> (VOXEL_AO_OFFSET + corner * VOXEL_AO_BITS) & VOXEL_AO_MASK) /
+        float(VOXEL_AO_MASK);
+}
+
+int get_corner(
+    const uvec2 face,
+    const int vertex)
+{
+#if VOXEL_AO
+    if (get_ao(face, 0) + get_ao(face, 3) > get_ao(face, 1) + get_ao(face, 2))
+    {
+        return flips[vertex];
+    }
+#endif
+    return indices[vertex];
+}
+
+vec2 get_tile(
+    const uint voxel,
+    const vec3 position)
+{
+    switch (get_direction(voxel))
+    {
+    case 2:
+    case 3:
+        return -position.zy;
+    case 4:
+    case 5:
+        return position.xz;
+    }
+    return -position.xy;
+}
+
+vec2 get_uv(
+    const uint voxel,
+    const vec2 tile)
+{
+    return get_atlas(vec2(voxel >> VOXEL_U_OFFSET & VOXEL_U_MASK,
+        voxel >> VOXEL_V_OFFSET & VOXEL_V_MASK) + fract(tile));
+}
+
 vec3 get_normal(
     const uint voxel)
 {
     return normals[get_direction(voxel)];
 }
 
+vec3 get_origin(
+    const uint voxel)
+{
+    return vec3(voxel >> VOXEL_X_OFFSET & VOXEL_X_MASK,
+        voxel >> VOXEL_Y_OFFSET & VOXEL_Y_MASK, voxel >> VOXEL_Z_OFFSET & VOXEL_Z_MASK);
+}
+
+vec3 get_position(
+    const uvec2 face,
+    const int vertex)
+{
+    const int i = get_corner(face, vertex);
+    const vec3 extent = vec3(face.y >> VOXEL_EXTENT_X_OFFSET & VOXEL_EXTENT_X_MASK,
+        face.y >> VOXEL_EXTENT_Y_OFFSET & VOXEL_EXTENT_Y_MASK,
+        face.y >> VOXEL_EXTENT_Z_OFFSET & VOXEL_EXTENT_Z_MASK);
+    return get_origin(face.x) + positions[get_direction(face.x)][i] * extent;
+}
+
+vec3 get_sprite(
+    const uint voxel,
+    const int vertex)
+{
+    return get_origin(voxel) + diagonals[vertex / 6][indices[vertex % 6]];
+}
+
 bool get_shadow(
     const uint voxel)
 {
@@ -67,14 +149,13 @@ vec3 get_sky(
 float get_fog(
     const float x)
 {
-    return min(pow(x / 250.0, 2.5), 1.0);
+    return min(pow(x / WORLD_FOG, 2.5), 1.0);
 }
 
 vec4 get_color(
-    const sampler2D atlas,
+    vec4 color,
     const sampler2D shadowmap,
     const vec3 position,
-    const vec2 uv,
     const vec3 normal,
     const vec3 player_position,
     const vec3 shadow_position,
@@ -108,7 +189,6 @@ vec4 get_color(
         b = 0.4;
         c = max(angle, 0.0) * 0.6;
     }
-    vec4 color = texture(atlas, uv);
     color.a = clamp(color.a + alpha, 0.0, 1.0);
     const vec4 composite = vec4(color.xyz * (a + b + c + 0.3), color.a);
     const float dy = position.y - player_position.y;
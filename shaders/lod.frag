@@ -0,0 +1,38 @@
+#version 450
+
+#include "helpers.glsl"
+
+layout(location = 0) in flat uint i_voxel;
+layout(location = 1) in vec4 i_position;
+layout(location = 2) in vec2 i_tile;
+#if VOXEL_AO
+layout(location = 3) in float i_ao;
+#endif
+layout(location = 0) out vec4 o_position;
+layout(location = 1) out vec2 o_uv;
+layout(location = 2) out uint o_voxel;
+layout(set = 2, binding = 0) uniform sampler2D s_atlas;
+layout(set = 3, binding = 0) uniform t_inner
+{
+    vec4 u_inner;
+};
+
+void main()
+{
+    if (all(greaterThanEqual(i_position.xz, u_inner.xy)) && all(lessThan(i_position.xz, u_inner.zw)))
+    {
+        discard;
+    }
+    const vec2 uv = get_uv(i_voxel, i_tile);
+    const vec2 tile = get_atlas(i_tile);
+    if (textureGrad(s_atlas, uv, dFdx(tile), dFdy(tile)).a < 0.001)
+    {
+        discard;
+    }
+    o_position = i_position;
+#if VOXEL_AO
+    o_position.w = i_ao;
+#endif
+    o_uv = uv;
+    o_voxel = i_voxel;
+}
\ No newline at end of file
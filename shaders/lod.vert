@@ -0,0 +1,41 @@
+#version 450
+
+#include "helpers.glsl"
+
+layout(location = 0) in uvec2 i_face;
+layout(location = 0) out flat uint o_voxel;
+layout(location = 1) out vec4 o_position;
+layout(location = 2) out vec2 o_tile;
+#if VOXEL_AO
+layout(location = 3) out float o_ao;
+#endif
+layout(set = 1, binding = 0) uniform t_position
+{
+    ivec3 u_position;
+};
+layout(set = 1, binding = 1) uniform t_view
+{
+    mat4 u_view;
+};
+layout(set = 1, binding = 2) uniform t_proj
+{
+    mat4 u_proj;
+};
+layout(set = 1, binding = 3) uniform t_scale
+{
+    int u_scale;
+};
+
+void main()
+{
+    const vec3 position = get_position(i_face, gl_VertexIndex);
+    o_voxel = i_face.x;
+    o_position.xyz = u_position + position * vec3(u_scale, 1.0, u_scale);
+    o_tile = get_tile(i_face.x, position);
+#if VOXEL_AO
+    o_ao = 1.0;
+#endif
+    const vec4 view = u_view * vec4(o_position.xyz, 1.0);
+    o_position.w = view.z;
+    gl_Position = u_proj * view;
+}
\ No newline at end of file
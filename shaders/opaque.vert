@@ -2,29 +2,36 @@
 
 #include "helpers.glsl"
 
-layout(location = 0) in uint i_voxel;
+layout(location = 0) in uvec2 i_face;
 layout(location = 0) out flat uint o_voxel;
 layout(location = 1) out vec4 o_position;
-layout(location = 2) out vec2 o_uv;
-layout(set = 1, binding = 0) uniform t_position
+layout(location = 2) out vec2 o_tile;
+#if VOXEL_AO
+layout(location = 3) out float o_ao;
+#endif
+layout(set = 0, binding = 0) readonly buffer t_pages
 {
-    ivec3 u_position;
+    ivec2 b_pages[];
 };
-layout(set = 1, binding = 1) uniform t_view
+layout(set = 1, binding = 0) uniform t_view
 {
     mat4 u_view;
 };
-layout(set = 1, binding = 2) uniform t_proj
+layout(set = 1, binding = 1) uniform t_proj
 {
     mat4 u_proj;
 };
 
 void main()
 {
-    o_voxel = i_voxel;
-    o_position.xyz = u_position + get_position(i_voxel);
-    o_uv = get_uv(i_voxel);
-    const vec4 position = u_view * vec4(o_position.xyz, 1.0);
-    o_position.w = position.z;
-    gl_Position = u_proj * position;
+    const vec3 position = get_position(i_face, gl_VertexIndex);
+    o_voxel = i_face.x;
+    o_position.xyz = get_origin(b_pages[gl_InstanceIndex / WORLD_PAGE]) + position;
+    o_tile = get_tile(i_face.x, position);
+#if VOXEL_AO
+    o_ao = get_ao(i_face, get_corner(i_face, gl_VertexIndex));
+#endif
+    const vec4 view = u_view * vec4(o_position.xyz, 1.0);
+    o_position.w = view.z;
+    gl_Position = u_proj * view;
 }
\ No newline at end of file
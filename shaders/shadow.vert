@@ -2,24 +2,17 @@
 
 #include "helpers.glsl"
 
-layout(location = 0) in uint i_voxel;
-layout(set = 1, binding = 0) uniform t_position
+layout(location = 0) in uvec2 i_face;
+layout(set = 0, binding = 0) readonly buffer t_pages
 {
-    ivec3 u_position;
+    ivec2 b_pages[];
 };
-layout(set = 1, binding = 1) uniform t_matrix
+layout(set = 1, binding = 0) uniform t_matrix
 {
     mat4 u_matrix;
 };
 
 void main()
 {
-    if (get_shadow(i_voxel))
-    {
-        gl_Position = u_matrix * vec4(u_position + get_position(i_voxel), 1.0);
-    }
-    else
-    {
-        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
-    }
+    gl_Position = u_matrix * vec4(get_origin(b_pages[gl_InstanceIndex / WORLD_PAGE]) + get_position(i_face, gl_VertexIndex), 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+#version 450
+
+#include "helpers.glsl"
+
+layout(location = 0) in uvec2 i_sprites;
+layout(location = 0) out flat uint o_voxel;
+layout(location = 1) out vec4 o_position;
+layout(location = 2) out vec2 o_tile;
+#if VOXEL_AO
+layout(location = 3) out float o_ao;
+#endif
+layout(set = 0, binding = 0) readonly buffer t_pages
+{
+    ivec2 b_pages[];
+};
+layout(set = 1, binding = 0) uniform t_view
+{
+    mat4 u_view;
+};
+layout(set = 1, binding = 1) uniform t_proj
+{
+    mat4 u_proj;
+};
+
+void main()
+{
+    const uint voxel = i_sprites[gl_VertexIndex / 12];
+    if (voxel == 0)
+    {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        return;
+    }
+    const vec3 position = get_sprite(voxel, gl_VertexIndex % 12);
+    o_voxel = voxel;
+    o_position.xyz = get_origin(b_pages[gl_InstanceIndex / WORLD_PAGE]) + position;
+    o_tile = get_tile(voxel, position);
+#if VOXEL_AO
+    o_ao = 1.0;
+#endif
+    const vec4 view = u_view * vec4(o_position.xyz, 1.0);
+    o_position.w = view.z;
+    gl_Position = u_proj * view;
+}
\ No newline at end of file
@@ -16,7 +16,8 @@ bool test(
 {
     switch (direction)
     {
-    case 4: return position.y < neighbor.y;
+    case 4:
+    case VOXEL_SPRITE: return position.y < neighbor.y;
     case 5: return position.y > neighbor.y;
     case 2: return position.x < neighbor.x;
     case 3: return position.x > neighbor.x;
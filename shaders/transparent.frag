@@ -3,12 +3,13 @@
 #include "helpers.glsl"
 
 layout(location = 0) in vec3 i_position;
-layout(location = 1) in vec2 i_uv;
+layout(location = 1) in vec2 i_tile;
 layout(location = 2) in flat vec3 i_normal;
 layout(location = 3) in vec4 i_shadow_position;
 layout(location = 4) in flat uint i_shadowed;
 layout(location = 5) in float i_fog;
 layout(location = 6) in vec2 i_fragment;
+layout(location = 7) in flat uint i_voxel;
 layout(location = 0) out vec4 o_color;
 layout(set = 2, binding = 0) uniform sampler2D s_atlas;
 layout(set = 2, binding = 1) uniform sampler2D s_shadowmap;
@@ -24,11 +25,12 @@ layout(set = 3, binding = 1) uniform t_player_position
 
 void main()
 {
+    const vec2 uv = get_uv(i_voxel, i_tile);
+    const vec2 tile = get_atlas(i_tile);
     o_color = get_color(
-        s_atlas,
+        textureGrad(s_atlas, uv, dFdx(tile), dFdy(tile)),
         s_shadowmap,
         i_position,
-        i_uv,
         i_normal,
         u_player_position,
         i_shadow_position.xyz / i_shadow_position.w,
@@ -2,36 +2,40 @@
 
 #include "helpers.glsl"
 
-layout(location = 0) in uint i_voxel;
+layout(location = 0) in uvec2 i_face;
 layout(location = 0) out vec3 o_position;
-layout(location = 1) out vec2 o_uv;
+layout(location = 1) out vec2 o_tile;
 layout(location = 2) out flat vec3 o_normal;
 layout(location = 3) out vec4 o_shadow_position;
 layout(location = 4) out flat uint o_shadowed;
 layout(location = 5) out float o_fog;
 layout(location = 6) out vec2 o_fragment;
-layout(set = 1, binding = 0) uniform t_position
+layout(location = 7) out flat uint o_voxel;
+layout(set = 0, binding = 0) readonly buffer t_pages
 {
-    ivec3 u_position;
+    ivec2 b_pages[];
 };
-layout(set = 1, binding = 1) uniform t_matrix
+layout(set = 1, binding = 0) uniform t_matrix
 {
     mat4 u_matrix;
 };
-layout(set = 1, binding = 2) uniform t_player_position
+layout(set = 1, binding = 1) uniform t_player_position
 {
     vec3 u_player_position;
 };
-layout(set = 1, binding = 3) uniform t_shadow_matrix
+layout(set = 1, binding = 2) uniform t_shadow_matrix
 {
     mat4 u_shadow_matrix;
 };
 
 void main()
 {
-    o_position = u_position + get_position(i_voxel);
-    o_uv = get_uv(i_voxel);
-    o_shadowed = uint(get_shadowed(i_voxel));
+    const uint voxel = i_face.x;
+    const vec3 position = get_position(i_face, gl_VertexIndex);
+    o_position = get_origin(b_pages[gl_InstanceIndex / WORLD_PAGE]) + position;
+    o_tile = get_tile(voxel, position);
+    o_voxel = voxel;
+    o_shadowed = uint(get_shadowed(voxel));
     o_fog = get_fog(distance(o_position.xz, u_player_position.xz));
     gl_Position = u_matrix * vec4(o_position, 1.0);
     o_fragment = gl_Position.xy / gl_Position.w;
@@ -42,5 +46,5 @@ void main()
         return;
     }
     o_shadow_position = u_shadow_matrix * vec4(o_position, 1.0);
-    o_normal = get_normal(i_voxel);
+    o_normal = get_normal(voxel);
 }
\ No newline at end of file
@@ -0,0 +1,534 @@
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "block.h"
+#include "chunk.h"
+#include "helpers.h"
+#include "noise.h"
+#include "pipeline.h"
+#include "voxel.h"
+
+#define BENCH_X 8
+#define BENCH_Z 8
+#define BENCH_CHUNKS (BENCH_X * BENCH_Z)
+#define BENCH_ITERATIONS 10
+#define BENCH_AREA 512
+
+#if CHUNK_LAYOUT == CHUNK_LAYOUT_LINEAR
+#define BENCH_LAYOUT "linear"
+#elif CHUNK_LAYOUT == CHUNK_LAYOUT_TILED
+#define BENCH_LAYOUT "tiled"
+#elif CHUNK_LAYOUT == CHUNK_LAYOUT_MORTON
+#define BENCH_LAYOUT "morton"
+#endif
+
+#if VOXEL_GREEDY
+#define BENCH_MESHER "greedy"
+#else
+#define BENCH_MESHER "naive"
+#endif
+
+#if VOXEL_AO
+#define BENCH_AO "baked ao"
+#else
+#define BENCH_AO "ssao"
+#endif
+
+static terrain_t terrain;
+static voxel_input_t input;
+static uint16_t buckets[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS];
+static chunk_input_t generated;
+
+static float get_ms(
+    const uint64_t start)
+{
+    const uint64_t end = SDL_GetPerformanceCounter();
+    return (end - start) * 1000.0f / SDL_GetPerformanceFrequency();
+}
+
+static void generate()
+{
+    const uint64_t start = SDL_GetPerformanceCounter();
+    for (int x = 0; x < BENCH_X; x++)
+    for (int z = 0; z < BENCH_Z; z++)
+    {
+        chunk_t* chunk = terrain_get(&terrain, x, z);
+        noise_generate(&generated, x, z);
+        chunk_set_blocks(chunk, &generated);
+    }
+    SDL_Log("generate: %.2f ms/chunk", get_ms(start) / BENCH_CHUNKS);
+}
+
+static void memory()
+{
+    const size_t before = sizeof(block_t) * CHUNK_X * CHUNK_Y * CHUNK_Z;
+    size_t after = 0;
+    int types[SECTION_TYPE_MIXED + 1] = {0};
+    for (int x = 0; x < BENCH_X; x++)
+    for (int z = 0; z < BENCH_Z; z++)
+    {
+        const chunk_t* chunk = terrain_get(&terrain, x, z);
+        after += chunk_get_bytes(chunk);
+        for (int i = 0; i < CHUNK_SECTIONS; i++)
+        {
+            types[chunk->sections[i].type]++;
+        }
+    }
+    after /= BENCH_CHUNKS;
+    SDL_Log("memory: %zu bytes/chunk dense, %zu bytes/chunk palette", before, after);
+    SDL_Log("sections: %.1f empty, %.1f uniform, %.1f mixed per chunk",
+        (float) types[SECTION_TYPE_EMPTY] / BENCH_CHUNKS,
+        (float) types[SECTION_TYPE_UNIFORM] / BENCH_CHUNKS,
+        (float) types[SECTION_TYPE_MIXED] / BENCH_CHUNKS);
+}
+
+static void mesh()
+{
+    voxel_arena_t arenas[CHUNK_MESH_COUNT] = {0};
+    uint64_t faces = 0;
+    uint64_t meshes[CHUNK_MESH_COUNT] = {0};
+    int count = 0;
+    const uint64_t start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+    for (int x = 1; x < BENCH_X - 1; x++)
+    for (int z = 1; z < BENCH_Z - 1; z++)
+    {
+        const chunk_t* neighbors[DIRECTION_2];
+        for (direction_t d = 0; d < DIRECTION_2; d++)
+        {
+            neighbors[d] = terrain_get(&terrain, x + directions[d][0], z + directions[d][2]);
+        }
+        const chunk_t* corners[DIAGONAL_COUNT];
+        for (diagonal_t d = 0; d < DIAGONAL_COUNT; d++)
+        {
+            corners[d] = terrain_get(&terrain, x + diagonals[d][0], z + diagonals[d][1]);
+        }
+        const chunk_t* chunk = terrain_get(&terrain, x, z);
+        voxel_copy(&input, chunk, neighbors, corners);
+        if (!voxel_fill(&input, chunk, CHUNK_DIRTY, arenas, buckets))
+        {
+            SDL_Log("Failed to mesh chunk");
+            break;
+        }
+        for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+        {
+            faces += arenas[mesh].size;
+            meshes[mesh] += arenas[mesh].size;
+        }
+        count++;
+    }
+    const float ms = get_ms(start);
+    SDL_Log("mesh (%s, %s, %s, %d lanes, %dx%d): %.3f ms/chunk, %.1f M blocks/s, %d faces/chunk, %d bytes/chunk",
+        BENCH_LAYOUT, BENCH_MESHER, BENCH_AO, VOXEL_LANES, CHUNK_X, CHUNK_Z, ms / count,
+        (float) count * CHUNK_X * CHUNK_Y * CHUNK_Z / (ms * 1000.0f),
+        (int) (faces / count), (int) (faces * 8 / count));
+    SDL_Log("shadow: %d faces/chunk (%d opaque faces/chunk)",
+        (int) (meshes[CHUNK_MESH_SHADOW] / count), (int) (meshes[CHUNK_MESH_OPAQUE] / count));
+    SDL_Log("area: %.3f ms and %d chunk draws per %dx%d blocks",
+        ms / count * BENCH_AREA * BENCH_AREA / (CHUNK_X * CHUNK_Z),
+        BENCH_AREA * BENCH_AREA / (CHUNK_X * CHUNK_Z),
+        BENCH_AREA, BENCH_AREA);
+    voxel_free(arenas);
+}
+
+static void hash()
+{
+    uint64_t value = 0;
+    int count = 0;
+    const uint64_t start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+    for (int x = 1; x < BENCH_X - 1; x++)
+    for (int z = 1; z < BENCH_Z - 1; z++)
+    {
+        const chunk_t* neighbors[DIRECTION_2];
+        for (direction_t d = 0; d < DIRECTION_2; d++)
+        {
+            neighbors[d] = terrain_get(&terrain, x + directions[d][0], z + directions[d][2]);
+        }
+        const chunk_t* corners[DIAGONAL_COUNT];
+        for (diagonal_t d = 0; d < DIAGONAL_COUNT; d++)
+        {
+            corners[d] = terrain_get(&terrain, x + diagonals[d][0], z + diagonals[d][1]);
+        }
+        const chunk_t* chunk = terrain_get(&terrain, x, z);
+        voxel_copy(&input, chunk, neighbors, corners);
+        value += voxel_hash(&input, chunk);
+        count++;
+    }
+    SDL_Log("copy and hash: %.3f ms/chunk (%016llx)", get_ms(start) / count, (unsigned long long) value);
+}
+
+static void edit()
+{
+    voxel_arena_t arenas[CHUNK_MESH_COUNT] = {0};
+    uint64_t faces = 0;
+    int count = 0;
+    const uint64_t start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+    for (int x = 1; x < BENCH_X - 1; x++)
+    for (int z = 1; z < BENCH_Z - 1; z++)
+    {
+        const chunk_t* neighbors[DIRECTION_2];
+        for (direction_t d = 0; d < DIRECTION_2; d++)
+        {
+            neighbors[d] = terrain_get(&terrain, x + directions[d][0], z + directions[d][2]);
+        }
+        const chunk_t* corners[DIAGONAL_COUNT];
+        for (diagonal_t d = 0; d < DIAGONAL_COUNT; d++)
+        {
+            corners[d] = terrain_get(&terrain, x + diagonals[d][0], z + diagonals[d][1]);
+        }
+        const chunk_t* chunk = terrain_get(&terrain, x, z);
+        const uint32_t sections = 1u << ((chunk->high - 1) / SECTION_Y);
+        voxel_copy(&input, chunk, neighbors, corners);
+        if (!voxel_fill(&input, chunk, sections, arenas, buckets))
+        {
+            SDL_Log("Failed to mesh section");
+            break;
+        }
+        for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+        {
+            faces += arenas[mesh].size;
+        }
+        count++;
+    }
+    SDL_Log("edit: %.3f ms/section, %d bytes/section",
+        get_ms(start) / count, (int) (faces * 8 / count));
+    voxel_free(arenas);
+}
+
+static void lod()
+{
+    static uint8_t heights[CHUNK_X + 2][CHUNK_Z + 2];
+    static block_t blocks[CHUNK_X][CHUNK_Z];
+    voxel_arena_t arena = {0};
+    for (int level = 1; level <= WORLD_LODS; level++)
+    {
+        const int step = 1 << level;
+        uint64_t faces = 0;
+        int count = 0;
+        const uint64_t start = SDL_GetPerformanceCounter();
+        for (int x = 0; x < BENCH_X; x++)
+        for (int z = 0; z < BENCH_Z; z++)
+        {
+            for (int a = -1; a <= CHUNK_X; a++)
+            for (int b = -1; b <= CHUNK_Z; b++)
+            {
+                int y;
+                const block_t block = noise_surface((x * CHUNK_X + a) * step, (z * CHUNK_Z + b) * step, &y);
+                heights[a + 1][b + 1] = y;
+                if (a >= 0 && b >= 0 && a < CHUNK_X && b < CHUNK_Z)
+                {
+                    blocks[a][b] = block;
+                }
+            }
+            if (!voxel_lod(heights, blocks, &arena))
+            {
+                SDL_Log("Failed to mesh lod");
+                break;
+            }
+            faces += arena.size;
+            count++;
+        }
+        SDL_Log("lod %d: %.3f ms/tile, %d bytes/tile, %d chunks/tile",
+            level, get_ms(start) / count, (int) (faces * 8 / count), step * step);
+    }
+    free(arena.data);
+}
+
+#if VOXEL_COMPUTE
+static int compare(
+    const void* a,
+    const void* b)
+{
+    const uint64_t l = *(const uint64_t*) a;
+    const uint64_t r = *(const uint64_t*) b;
+    return (l > r) - (l < r);
+}
+
+static uint64_t get_face(
+    const chunk_mesh_t mesh,
+    const uint32_t a,
+    const uint32_t b)
+{
+    if (mesh == CHUNK_MESH_SHADOW || mesh == CHUNK_MESH_SPRITE)
+    {
+        return a;
+    }
+    return (uint64_t) b << 32 | a;
+}
+
+static uint32_t expand(
+    const voxel_arena_t* arena,
+    const chunk_mesh_t mesh,
+    uint64_t* faces,
+    const uint32_t capacity)
+{
+    const uint32_t position =
+        (uint32_t) VOXEL_X_MASK << VOXEL_X_OFFSET |
+        (uint32_t) VOXEL_Y_MASK << VOXEL_Y_OFFSET |
+        (uint32_t) VOXEL_Z_MASK << VOXEL_Z_OFFSET;
+    const uint32_t extent =
+        1 << VOXEL_EXTENT_X_OFFSET |
+        1 << VOXEL_EXTENT_Y_OFFSET |
+        1 << VOXEL_EXTENT_Z_OFFSET;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < arena->size; i++)
+    {
+        const uint32_t* face = &arena->data[i * 2];
+        if (mesh == CHUNK_MESH_SPRITE)
+        {
+            for (int j = 0; j < 2; j++)
+            {
+                if (face[j] && count < capacity)
+                {
+                    faces[count] = get_face(mesh, face[j], 0);
+                }
+                count += face[j] != 0;
+            }
+            continue;
+        }
+        const int x = face[0] >> VOXEL_X_OFFSET & VOXEL_X_MASK;
+        const int y = face[0] >> VOXEL_Y_OFFSET & VOXEL_Y_MASK;
+        const int z = face[0] >> VOXEL_Z_OFFSET & VOXEL_Z_MASK;
+        const int w = face[1] >> VOXEL_EXTENT_X_OFFSET & VOXEL_EXTENT_X_MASK;
+        const int h = face[1] >> VOXEL_EXTENT_Y_OFFSET & VOXEL_EXTENT_Y_MASK;
+        const int d = face[1] >> VOXEL_EXTENT_Z_OFFSET & VOXEL_EXTENT_Z_MASK;
+        const uint32_t ao = face[1] >> VOXEL_AO_OFFSET << VOXEL_AO_OFFSET;
+        for (int a = x; a < x + w; a++)
+        for (int b = y; b < y + h; b++)
+        for (int c = z; c < z + d; c++)
+        {
+            if (count < capacity)
+            {
+                const uint32_t voxel = (face[0] & ~position) |
+                    (uint32_t) a << VOXEL_X_OFFSET |
+                    (uint32_t) b << VOXEL_Y_OFFSET |
+                    (uint32_t) c << VOXEL_Z_OFFSET;
+                faces[count] = get_face(mesh, voxel, extent | ao);
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+static bool download(
+    SDL_GPUDevice* device,
+    SDL_GPUBuffer* vbo,
+    SDL_GPUBuffer* indirect,
+    const uint32_t size,
+    SDL_GPUTransferBuffer* tbo)
+{
+    SDL_GPUCommandBuffer* command_buffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!command_buffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return false;
+    }
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+    if (!copy_pass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(command_buffer);
+        return false;
+    }
+    SDL_GPUBufferRegion region = {0};
+    region.buffer = vbo;
+    region.size = size * 8;
+    SDL_GPUTransferBufferLocation location = {0};
+    location.transfer_buffer = tbo;
+    SDL_DownloadFromGPUBuffer(copy_pass, &region, &location);
+    region.buffer = indirect;
+    region.size = sizeof(SDL_GPUIndirectDrawCommand) * CHUNK_MESH_COUNT;
+    location.offset = size * 8;
+    SDL_DownloadFromGPUBuffer(copy_pass, &region, &location);
+    SDL_EndGPUCopyPass(copy_pass);
+    SDL_GPUFence* fence = SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer);
+    if (!fence)
+    {
+        SDL_Log("Failed to submit command buffer: %s", SDL_GetError());
+        return false;
+    }
+    const bool status = SDL_WaitForGPUFences(device, true, &fence, 1);
+    SDL_ReleaseGPUFence(device, fence);
+    if (!status)
+    {
+        SDL_Log("Failed to wait for fence: %s", SDL_GetError());
+    }
+    return status;
+}
+
+static bool compute_chunk(
+    SDL_GPUDevice* device,
+    const chunk_t* chunk,
+    const int32_t origin[2],
+    voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    SDL_GPUTransferBuffer** tbo,
+    uint32_t* tbo_capacity,
+    SDL_GPUBuffer** sbo,
+    uint32_t* sbo_capacity,
+    SDL_GPUBuffer** indirect,
+    int* mismatches)
+{
+    uint32_t counts[CHUNK_MESH_COUNT];
+    uint32_t offsets[CHUNK_MESH_COUNT];
+    uint32_t capacities[CHUNK_MESH_COUNT];
+    uint32_t size = 0;
+    voxel_count(&input, counts);
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        offsets[mesh] = size;
+        capacities[mesh] = (counts[mesh] + WORLD_PAGE - 1) / WORLD_PAGE * WORLD_PAGE;
+        size += capacities[mesh];
+    }
+    size = max(size, WORLD_PAGE);
+    SDL_GPUBufferCreateInfo bci = {0};
+    bci.usage = SDL_GPU_BUFFERUSAGE_VERTEX | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+    bci.size = size * 8;
+    SDL_GPUBuffer* vbo = SDL_CreateGPUBuffer(device, &bci);
+    bci.usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ;
+    bci.size = size / WORLD_PAGE * 8;
+    SDL_GPUBuffer* pages = SDL_CreateGPUBuffer(device, &bci);
+    SDL_GPUTransferBufferCreateInfo tbci = {0};
+    tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD;
+    tbci.size = size * 8 + sizeof(SDL_GPUIndirectDrawCommand) * CHUNK_MESH_COUNT;
+    SDL_GPUTransferBuffer* results = SDL_CreateGPUTransferBuffer(device, &tbci);
+    uint64_t* expected = SDL_malloc(size * 8);
+    uint64_t* actual = SDL_malloc(size * 8);
+    bool status = vbo && pages && results && expected && actual;
+    if (!status)
+    {
+        SDL_Log("Failed to create compute buffers: %s", SDL_GetError());
+    }
+    status = status && voxel_compute(&input, chunk, device, tbo, tbo_capacity, sbo, sbo_capacity,
+        offsets, capacities, origin, vbo, pages, indirect);
+    status = status && download(device, vbo, *indirect, size, results);
+    const uint32_t* data = status ? SDL_MapGPUTransferBuffer(device, results, false) : NULL;
+    if (status && !data)
+    {
+        SDL_Log("Failed to map results buffer: %s", SDL_GetError());
+        status = false;
+    }
+    for (chunk_mesh_t mesh = 0; status && mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        const SDL_GPUIndirectDrawCommand* commands = (const SDL_GPUIndirectDrawCommand*) (data + size * 2);
+        const uint32_t count = commands[mesh].num_instances;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const uint32_t* face = &data[(offsets[mesh] + i) * 2];
+            actual[i] = get_face(mesh, face[0], face[1]);
+        }
+        const uint32_t other = expand(&arenas[mesh], mesh, expected, capacities[mesh]);
+        if (count != other || (mesh != CHUNK_MESH_SHADOW && count != counts[mesh]))
+        {
+            SDL_Log("Mismatched mesh %d count: %u gpu, %u cpu, %u counted",
+                mesh, count, other, counts[mesh]);
+            (*mismatches)++;
+            continue;
+        }
+        qsort(expected, count, 8, compare);
+        qsort(actual, count, 8, compare);
+        if (memcmp(expected, actual, count * 8))
+        {
+            SDL_Log("Mismatched mesh %d faces", mesh);
+            (*mismatches)++;
+        }
+    }
+    if (data)
+    {
+        SDL_UnmapGPUTransferBuffer(device, results);
+    }
+    SDL_free(expected);
+    SDL_free(actual);
+    SDL_ReleaseGPUTransferBuffer(device, results);
+    SDL_ReleaseGPUBuffer(device, vbo);
+    SDL_ReleaseGPUBuffer(device, pages);
+    return status;
+}
+
+static bool compute()
+{
+    SDL_GPUDevice* device = SDL_CreateGPUDevice(SDL_GPU_SHADERFORMAT_SPIRV | SDL_GPU_SHADERFORMAT_MSL, true, NULL);
+    if (!device)
+    {
+        SDL_Log("Failed to create device: %s", SDL_GetError());
+        return false;
+    }
+    if (!pipeline_init_compute(device))
+    {
+        SDL_Log("Failed to initialize compute pipeline");
+        SDL_DestroyGPUDevice(device);
+        return false;
+    }
+    voxel_arena_t arenas[CHUNK_MESH_COUNT] = {0};
+    SDL_GPUTransferBuffer* tbo = NULL;
+    uint32_t tbo_capacity = 0;
+    SDL_GPUBuffer* sbo = NULL;
+    uint32_t sbo_capacity = 0;
+    SDL_GPUBuffer* indirect = NULL;
+    int mismatches = 0;
+    int count = 0;
+    bool status = true;
+    for (int x = 1; status && x < BENCH_X - 1; x++)
+    for (int z = 1; status && z < BENCH_Z - 1; z++)
+    {
+        const chunk_t* neighbors[DIRECTION_2];
+        for (direction_t d = 0; d < DIRECTION_2; d++)
+        {
+            neighbors[d] = terrain_get(&terrain, x + directions[d][0], z + directions[d][2]);
+        }
+        const chunk_t* corners[DIAGONAL_COUNT];
+        for (diagonal_t d = 0; d < DIAGONAL_COUNT; d++)
+        {
+            corners[d] = terrain_get(&terrain, x + diagonals[d][0], z + diagonals[d][1]);
+        }
+        const chunk_t* chunk = terrain_get(&terrain, x, z);
+        const int32_t origin[2] = {x * CHUNK_X, z * CHUNK_Z};
+        voxel_copy(&input, chunk, neighbors, corners);
+        status = voxel_fill(&input, chunk, CHUNK_DIRTY, arenas, buckets) &&
+            compute_chunk(device, chunk, origin, arenas, &tbo, &tbo_capacity,
+                &sbo, &sbo_capacity, &indirect, &mismatches);
+        count++;
+    }
+    SDL_Log("compute: %d chunks, %d mismatched meshes", count, mismatches);
+    voxel_free(arenas);
+    SDL_ReleaseGPUTransferBuffer(device, tbo);
+    SDL_ReleaseGPUBuffer(device, sbo);
+    SDL_ReleaseGPUBuffer(device, indirect);
+    pipeline_free();
+    SDL_DestroyGPUDevice(device);
+    return status && !mismatches;
+}
+#endif
+
+int main(
+    int argc,
+    char** argv)
+{
+    static_assert(BENCH_X <= WORLD_X, "");
+    static_assert(BENCH_Z <= WORLD_Z, "");
+    if (!terrain_init(&terrain, WORLD_X, WORLD_Z))
+    {
+        SDL_Log("Failed to create terrain");
+        return EXIT_FAILURE;
+    }
+    int size;
+    terrain_move(&terrain, 0, 0, WORLD_X, WORLD_Z, &size);
+    generate();
+    memory();
+    mesh();
+    hash();
+    edit();
+    lod();
+#if VOXEL_COMPUTE
+    const bool status = compute();
+#else
+    const bool status = true;
+#endif
+    terrain_free(&terrain);
+    return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -195,7 +195,7 @@ void camera_init(
     camera->height = 480.0f;
     camera->fov = rad(90.0f);
     camera->near = 1.0f;
-    camera->far = 300.0f;
+    camera->far = type == CAMERA_TYPE_PERSPECTIVE ? WORLD_FOG : 300.0f;
     camera->ortho = 300.0f;
     camera->dirty = true;
 }
@@ -3,9 +3,388 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+// #include <threads.h>
+#include "tinycthread.h"
 #include "chunk.h"
 #include "helpers.h"
 
+#define BITS(n) ( \
+    (n) > 128 ? 8 : \
+    (n) > 64 ? 7 : \
+    (n) > 32 ? 6 : \
+    (n) > 16 ? 5 : \
+    (n) > 8 ? 4 : \
+    (n) > 4 ? 3 : \
+    (n) > 2 ? 2 : \
+    (n) > 1 ? 1 : 0)
+
+static int get_index(
+    const int x,
+    const int y,
+    const int z)
+{
+    static_assert(CHUNK_Y % SECTION_Y == 0, "");
+#if CHUNK_LAYOUT == CHUNK_LAYOUT_LINEAR
+    return (x * SECTION_Y + y) * CHUNK_Z + z;
+#elif CHUNK_LAYOUT == CHUNK_LAYOUT_TILED
+    const int a = x >> 2;
+    const int b = y >> 2;
+    const int c = z >> 2;
+    const int tile = (a * ((SECTION_Y + 3) >> 2) + b) * ((CHUNK_Z + 3) >> 2) + c;
+    return tile << 6 | (x & 3) << 4 | (y & 3) << 2 | (z & 3);
+#elif CHUNK_LAYOUT == CHUNK_LAYOUT_MORTON
+    int index = 0;
+    int shift = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        if (i < BITS(CHUNK_X))
+        {
+            index |= (x >> i & 1) << shift++;
+        }
+        if (i < BITS(SECTION_Y))
+        {
+            index |= (y >> i & 1) << shift++;
+        }
+        if (i < BITS(CHUNK_Z))
+        {
+            index |= (z >> i & 1) << shift++;
+        }
+    }
+    return index;
+#else
+#error "Unknown CHUNK_LAYOUT"
+#endif
+}
+
+static int get_volume()
+{
+#if CHUNK_LAYOUT == CHUNK_LAYOUT_LINEAR
+    return CHUNK_X * SECTION_Y * CHUNK_Z;
+#elif CHUNK_LAYOUT == CHUNK_LAYOUT_TILED
+    return ((CHUNK_X + 3) & ~3) * ((SECTION_Y + 3) & ~3) * ((CHUNK_Z + 3) & ~3);
+#elif CHUNK_LAYOUT == CHUNK_LAYOUT_MORTON
+    return 1 << (BITS(CHUNK_X) + BITS(SECTION_Y) + BITS(CHUNK_Z));
+#endif
+}
+
+static int get_words(
+    const int bits)
+{
+    return (get_volume() * bits + 31) / 32;
+}
+
+#define POOL_SLAB (2 * 1024 * 1024)
+#define POOL_CLASSES 5
+#define POOL_MASKS 4
+
+typedef struct node
+{
+    struct node* next;
+}
+node_t;
+
+typedef struct
+{
+    mtx_t mtx;
+    node_t* nodes[POOL_CLASSES];
+    node_t* slabs;
+    uint8_t* slab;
+    int size;
+}
+pool_t;
+
+static pool_t pool;
+static uint8_t flags[BLOCK_COUNT];
+
+static int get_stride(
+    const int i)
+{
+    int bytes;
+    if (i == POOL_MASKS)
+    {
+        bytes = CHUNK_MASK_COUNT * SECTION_Y * CHUNK_Z * sizeof(uint32_t);
+    }
+    else
+    {
+        bytes = get_words(1 << i) * sizeof(uint32_t);
+    }
+    return (bytes + 63) & ~63;
+}
+
+static uint32_t* acquire(
+    const int i)
+{
+    const int stride = get_stride(i);
+    assert(i < POOL_CLASSES);
+    assert(stride <= POOL_SLAB - 64);
+    mtx_lock(&pool.mtx);
+    node_t* node = pool.nodes[i];
+    if (node)
+    {
+        pool.nodes[i] = node->next;
+    }
+    else
+    {
+        if (!pool.slab || pool.size + stride > POOL_SLAB)
+        {
+            node_t* slab = SDL_aligned_alloc(POOL_SLAB, POOL_SLAB);
+            assert(slab);
+            slab->next = pool.slabs;
+            pool.slabs = slab;
+            pool.slab = (uint8_t*) slab;
+            pool.size = 64;
+        }
+        node = (node_t*) (pool.slab + pool.size);
+        pool.size += stride;
+    }
+    mtx_unlock(&pool.mtx);
+    memset(node, 0, stride);
+    return (uint32_t*) node;
+}
+
+static void release(
+    uint32_t* data,
+    const int i)
+{
+    if (!data)
+    {
+        return;
+    }
+    node_t* node = (node_t*) data;
+    assert(i < POOL_CLASSES);
+    mtx_lock(&pool.mtx);
+    node->next = pool.nodes[i];
+    pool.nodes[i] = node;
+    mtx_unlock(&pool.mtx);
+}
+
+static uint32_t read_index(
+    const uint32_t* indices,
+    const int bits,
+    const int i)
+{
+    const int j = i * bits;
+    return indices[j >> 5] >> (j & 31) & ((1u << bits) - 1);
+}
+
+static void write_index(
+    uint32_t* indices,
+    const int bits,
+    const int i,
+    const uint32_t index)
+{
+    const int j = i * bits;
+    const uint32_t mask = ((1u << bits) - 1) << (j & 31);
+    indices[j >> 5] = (indices[j >> 5] & ~mask) | (index << (j & 31));
+}
+
+static void update(
+    section_t* section)
+{
+    assert(section);
+    if (section->bits)
+    {
+        section->type = SECTION_TYPE_MIXED;
+    }
+    else if (section->palette[0] == BLOCK_EMPTY)
+    {
+        section->type = SECTION_TYPE_EMPTY;
+    }
+    else
+    {
+        section->type = SECTION_TYPE_UNIFORM;
+    }
+}
+
+static void repack(
+    section_t* section,
+    const int bits,
+    const uint8_t remap[BLOCK_COUNT])
+{
+    assert(section);
+    uint32_t* indices = NULL;
+    if (bits)
+    {
+        indices = acquire(BITS(bits));
+    }
+    if (bits && !section->bits)
+    {
+        section->masks = acquire(POOL_MASKS);
+        for (chunk_mask_t mask = 0; mask < CHUNK_MASK_COUNT; mask++)
+        {
+            if (!(flags[section->palette[0]] >> mask & 1))
+            {
+                continue;
+            }
+            uint32_t* rows = &section->masks[mask * SECTION_Y * CHUNK_Z];
+            for (int i = 0; i < SECTION_Y * CHUNK_Z; i++)
+            {
+                rows[i] = CHUNK_ROW;
+            }
+        }
+    }
+    else if (!bits && section->bits)
+    {
+        release(section->masks, POOL_MASKS);
+        section->masks = NULL;
+    }
+    if (bits && (section->bits || remap))
+    {
+        for (int i = 0; i < get_volume(); i++)
+        {
+            uint32_t index = 0;
+            if (section->bits)
+            {
+                index = read_index(section->indices, section->bits, i);
+            }
+            if (remap)
+            {
+                index = remap[index];
+            }
+            write_index(indices, bits, i, index);
+        }
+    }
+    release(section->indices, BITS(section->bits));
+    section->indices = indices;
+    section->bits = bits;
+}
+
+static void compact(
+    section_t* section)
+{
+    assert(section);
+    if (!section->bits)
+    {
+        return;
+    }
+    int counts[BLOCK_COUNT] = {0};
+    for (int x = 0; x < CHUNK_X; x++)
+    for (int y = 0; y < SECTION_Y; y++)
+    for (int z = 0; z < CHUNK_Z; z++)
+    {
+        const int i = get_index(x, y, z);
+        counts[read_index(section->indices, section->bits, i)]++;
+    }
+    block_t palette[BLOCK_COUNT];
+    uint8_t remap[BLOCK_COUNT] = {0};
+    int count = 0;
+    for (int i = 0; i < section->count; i++)
+    {
+        if (counts[i])
+        {
+            remap[i] = count;
+            palette[count++] = section->palette[i];
+        }
+    }
+    if (count == section->count)
+    {
+        return;
+    }
+    int bits = 0;
+    while ((1 << bits) < count)
+    {
+        bits = bits ? bits * 2 : 1;
+    }
+    repack(section, bits, remap);
+    section->count = count;
+    for (int i = 0; i < count; i++)
+    {
+        section->palette[i] = palette[i];
+        section->lookup[palette[i]] = i;
+    }
+    update(section);
+}
+
+static block_t get_block(
+    const chunk_t* chunk,
+    const int x,
+    const int y,
+    const int z)
+{
+    const section_t* section = &chunk->sections[y / SECTION_Y];
+    if (!section->bits)
+    {
+        return section->palette[0];
+    }
+    const int i = get_index(x, y % SECTION_Y, z);
+    return section->palette[read_index(section->indices, section->bits, i)];
+}
+
+static void update_extent(
+    chunk_t* chunk)
+{
+    assert(chunk);
+    chunk->low = CHUNK_Y;
+    chunk->high = 0;
+    for (int x = 0; x < CHUNK_X; x++)
+    for (int z = 0; z < CHUNK_Z; z++)
+    {
+        if (chunk->lows[x][z] < chunk->highs[x][z])
+        {
+            chunk->low = min(chunk->low, chunk->lows[x][z]);
+            chunk->high = max(chunk->high, chunk->highs[x][z]);
+        }
+    }
+    if (chunk->low > chunk->high)
+    {
+        chunk->low = 0;
+    }
+}
+
+static void update_height(
+    chunk_t* chunk,
+    const int x,
+    const int y,
+    const int z,
+    const block_t block)
+{
+    static_assert(CHUNK_Y <= UINT8_MAX, "");
+    uint8_t* low = &chunk->lows[x][z];
+    uint8_t* high = &chunk->highs[x][z];
+    if (block != BLOCK_EMPTY)
+    {
+        if (*low == *high)
+        {
+            *low = y;
+            *high = y + 1;
+        }
+        else
+        {
+            *low = min(*low, y);
+            *high = max(*high, y + 1);
+        }
+        if (chunk->low == chunk->high)
+        {
+            chunk->low = y;
+            chunk->high = y + 1;
+        }
+        else
+        {
+            chunk->low = min(chunk->low, y);
+            chunk->high = max(chunk->high, y + 1);
+        }
+        return;
+    }
+    if (y != *low && y != *high - 1)
+    {
+        return;
+    }
+    while (*high > *low && get_block(chunk, x, *high - 1, z) == BLOCK_EMPTY)
+    {
+        (*high)--;
+    }
+    while (*low < *high && get_block(chunk, x, *low, z) == BLOCK_EMPTY)
+    {
+        (*low)++;
+    }
+    if (*low == *high)
+    {
+        *low = 0;
+        *high = 0;
+    }
+    update_extent(chunk);
+}
+
 block_t chunk_get_block(
     const chunk_t* chunk,
     const int x,
@@ -14,8 +393,85 @@ block_t chunk_get_block(
 {
     assert(chunk);
     assert(chunk_in(x, y, z));
-    assert(!chunk->load);
-    return chunk->blocks[x][y][z];
+    return get_block(chunk, x, y, z);
+}
+
+uint32_t chunk_get_mask(
+    const chunk_t* chunk,
+    const chunk_mask_t mask,
+    const int y,
+    const int z)
+{
+    assert(chunk);
+    assert(mask < CHUNK_MASK_COUNT);
+    assert(chunk_in(0, y, z));
+    const section_t* section = &chunk->sections[y / SECTION_Y];
+    if (!section->bits)
+    {
+        return flags[section->palette[0]] >> mask & 1 ? CHUNK_ROW : 0;
+    }
+    return section->masks[(mask * SECTION_Y + y % SECTION_Y) * CHUNK_Z + z];
+}
+
+void chunk_get_rows(
+    const chunk_t* chunk,
+    const chunk_mask_t mask,
+    const int y,
+    uint32_t rows[CHUNK_Z])
+{
+    assert(chunk);
+    assert(mask < CHUNK_MASK_COUNT);
+    assert(y >= 0 && y < CHUNK_Y);
+    const section_t* section = &chunk->sections[y / SECTION_Y];
+    if (!section->bits)
+    {
+        const uint32_t row = flags[section->palette[0]] >> mask & 1 ? CHUNK_ROW : 0;
+        for (int z = 0; z < CHUNK_Z; z++)
+        {
+            rows[z] = row;
+        }
+        return;
+    }
+    const int i = (mask * SECTION_Y + y % SECTION_Y) * CHUNK_Z;
+    memcpy(rows, &section->masks[i], CHUNK_Z * sizeof(uint32_t));
+}
+
+static void set_block(
+    section_t* section,
+    const int x,
+    const int y,
+    const int z,
+    const block_t block)
+{
+    int index = section->lookup[block];
+    if (index >= section->count || section->palette[index] != block)
+    {
+        if (section->count == 1 << section->bits)
+        {
+            repack(section, section->bits ? section->bits * 2 : 1, NULL);
+        }
+        index = section->count++;
+        section->palette[index] = block;
+        section->lookup[block] = index;
+        update(section);
+    }
+    if (section->bits)
+    {
+        write_index(section->indices, section->bits, get_index(x, y % SECTION_Y, z), index);
+        uint32_t* rows = &section->masks[(y % SECTION_Y) * CHUNK_Z + z];
+        for (chunk_mask_t mask = 0; mask < CHUNK_MASK_COUNT; mask++)
+        {
+            uint32_t* row = &rows[mask * SECTION_Y * CHUNK_Z];
+            if (flags[block] >> mask & 1)
+            {
+                *row |= 1u << x;
+            }
+            else
+            {
+                *row &= ~(1u << x);
+            }
+        }
+    }
 }
 
 void chunk_set_block(
@@ -27,8 +483,155 @@ void chunk_set_block(
 {
     assert(chunk);
     assert(chunk_in(x, y, z));
-    chunk->blocks[x][y][z] = block;
-    chunk->skip = false;
+    assert(block < BLOCK_COUNT);
+    set_block(&chunk->sections[y / SECTION_Y], x, y, z, block);
+    update_height(chunk, x, y, z, block);
+}
+
+void chunk_set_blocks(
+    chunk_t* chunk,
+    const chunk_input_t* input)
+{
+    assert(chunk);
+    assert(input);
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+    {
+        section_t* section = &chunk->sections[i];
+        repack(section, 0, NULL);
+        bool seen[BLOCK_COUNT] = {0};
+        int count = 0;
+        for (int x = 0; x < CHUNK_X; x++)
+        for (int z = 0; z < CHUNK_Z; z++)
+        {
+            const block_t* column = &input->blocks[x][z][i * SECTION_Y];
+            for (int y = 0; y < SECTION_Y; y++)
+            {
+                if (!seen[column[y]])
+                {
+                    seen[column[y]] = true;
+                    section->palette[count] = column[y];
+                    section->lookup[column[y]] = count;
+                    count++;
+                }
+            }
+        }
+        section->count = count;
+        int bits = 0;
+        while ((1 << bits) < count)
+        {
+            bits = bits ? bits * 2 : 1;
+        }
+        if (bits)
+        {
+            section->indices = acquire(BITS(bits));
+            section->masks = acquire(POOL_MASKS);
+            section->bits = bits;
+            for (int x = 0; x < CHUNK_X; x++)
+            for (int z = 0; z < CHUNK_Z; z++)
+            {
+                const block_t* column = &input->blocks[x][z][i * SECTION_Y];
+                for (int y = 0; y < SECTION_Y; y++)
+                {
+                    const block_t block = column[y];
+                    write_index(section->indices, bits, get_index(x, y, z), section->lookup[block]);
+                    uint32_t* rows = &section->masks[y * CHUNK_Z + z];
+                    for (chunk_mask_t mask = 0; mask < CHUNK_MASK_COUNT; mask++)
+                    {
+                        rows[mask * SECTION_Y * CHUNK_Z] |= (uint32_t) (flags[block] >> mask & 1) << x;
+                    }
+                }
+            }
+        }
+        update(section);
+    }
+    for (int x = 0; x < CHUNK_X; x++)
+    for (int z = 0; z < CHUNK_Z; z++)
+    {
+        const block_t* column = input->blocks[x][z];
+        int low = 0;
+        int high = CHUNK_Y;
+        while (low < high && column[low] == BLOCK_EMPTY)
+        {
+            low++;
+        }
+        while (high > low && column[high - 1] == BLOCK_EMPTY)
+        {
+            high--;
+        }
+        if (low == high)
+        {
+            low = 0;
+            high = 0;
+        }
+        chunk->lows[x][z] = low;
+        chunk->highs[x][z] = high;
+    }
+    update_extent(chunk);
+}
+
+void chunk_clear(
+    chunk_t* chunk)
+{
+    assert(chunk);
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+    {
+        section_t* section = &chunk->sections[i];
+        repack(section, 0, NULL);
+        section->count = 1;
+        section->palette[0] = BLOCK_EMPTY;
+        section->lookup[BLOCK_EMPTY] = 0;
+        update(section);
+    }
+    memset(chunk->lows, 0, sizeof(chunk->lows));
+    memset(chunk->highs, 0, sizeof(chunk->highs));
+    chunk->low = 0;
+    chunk->high = 0;
+}
+
+void chunk_compact(
+    chunk_t* chunk)
+{
+    assert(chunk);
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+    {
+        compact(&chunk->sections[i]);
+    }
+}
+
+size_t chunk_get_bytes(
+    const chunk_t* chunk)
+{
+    assert(chunk);
+    size_t bytes = sizeof(chunk_t);
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+    {
+        const section_t* section = &chunk->sections[i];
+        if (section->bits)
+        {
+            bytes += get_words(section->bits) * sizeof(uint32_t);
+            bytes += get_stride(POOL_MASKS);
+        }
+    }
+    return bytes;
+}
+
+uint64_t chunk_hash(
+    const chunk_t* chunk)
+{
+    assert(chunk);
+    uint64_t hash = 0;
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+    {
+        const section_t* section = &chunk->sections[i];
+        hash = hash_data(hash, &section->count, sizeof(section->count));
+        hash = hash_data(hash, &section->bits, sizeof(section->bits));
+        hash = hash_data(hash, section->palette, section->count * sizeof(block_t));
+        if (section->bits)
+        {
+            hash = hash_data(hash, section->indices, get_words(section->bits) * sizeof(uint32_t));
+        }
+    }
+    return hash;
 }
 
 void chunk_wrap(
@@ -39,9 +642,9 @@ void chunk_wrap(
     assert(x);
     assert(y);
     assert(z);
-    *x = (*x % CHUNK_X + CHUNK_X) % CHUNK_X;
+    *x &= CHUNK_X - 1;
     *y = (*y % CHUNK_Y + CHUNK_Y) % CHUNK_Y;
-    *z = (*z % CHUNK_Z + CHUNK_Z) % CHUNK_Z;
+    *z &= CHUNK_Z - 1;
 }
 
 bool chunk_in(
@@ -58,41 +661,140 @@ bool chunk_in(
         z < CHUNK_Z;
 }
 
-void terrain_init(
-    terrain_t* terrain)
+static int wrap(
+    const int x,
+    const int n)
+{
+    return (x % n + n) % n;
+}
+
+static int get_slot(
+    const terrain_t* terrain,
+    const int x,
+    const int z)
+{
+    return wrap(x, terrain->max_width) * terrain->max_depth + wrap(z, terrain->max_depth);
+}
+
+bool terrain_init(
+    terrain_t* terrain,
+    const int width,
+    const int depth)
 {
     assert(terrain);
+    assert(width > 0);
+    assert(depth > 0);
+    memset(terrain, 0, sizeof(terrain_t));
     terrain->x = INT_MAX;
     terrain->z = INT_MAX;
-    for (int x = 0; x < WORLD_X; x++)
-    for (int z = 0; z < WORLD_Z; z++)
+    terrain->width = width;
+    terrain->depth = depth;
+    terrain->max_width = width;
+    terrain->max_depth = depth;
+    terrain->count = width * depth;
+    static_assert(CHUNK_X <= 32, "");
+    static_assert(CHUNK_SECTIONS <= 32, "");
+    static_assert(CHUNK_MASK_COUNT <= 8, "");
+    for (block_t block = BLOCK_EMPTY; block < BLOCK_COUNT; block++)
     {
-        terrain->chunks[x][z] = calloc(1, sizeof(chunk_t));
-        assert(terrain->chunks[x][z]);
+        const bool occupied = block != BLOCK_EMPTY;
+        const bool cube = occupied && !block_sprite(block);
+        flags[block] = 0;
+        flags[block] |= occupied << CHUNK_MASK_OCCUPIED;
+        flags[block] |= cube << CHUNK_MASK_CUBE;
+        flags[block] |= (cube && block_opaque(block)) << CHUNK_MASK_OPAQUE;
+        flags[block] |= block_solid(block) << CHUNK_MASK_SOLID;
     }
+    memset(&pool, 0, sizeof(pool));
+    if (mtx_init(&pool.mtx, mtx_plain) != thrd_success)
+    {
+        SDL_Log("Failed to create mutex");
+        return false;
+    }
+    const int count = terrain->count;
+    terrain->chunks = SDL_aligned_alloc(POOL_SLAB, count * sizeof(chunk_t));
+    terrain->xs = calloc(count, sizeof(*terrain->xs));
+    terrain->zs = calloc(count, sizeof(*terrain->zs));
+    terrain->loads = calloc(count, sizeof(*terrain->loads));
+    terrain->meshes = calloc(count, sizeof(*terrain->meshes));
+    terrain->skips = calloc(count, sizeof(*terrain->skips));
+    terrain->lows = calloc(count, sizeof(*terrain->lows));
+    terrain->highs = calloc(count, sizeof(*terrain->highs));
+    terrain->sizes = calloc(count, sizeof(*terrain->sizes));
+    terrain->buckets = calloc(count, sizeof(*terrain->buckets));
+    terrain->capacities = calloc(count, sizeof(*terrain->capacities));
+    terrain->offsets = calloc(count, sizeof(*terrain->offsets));
+    terrain->indirects = calloc(count, sizeof(*terrain->indirects));
+    terrain->indices = calloc(count * 2, sizeof(*terrain->indices));
+    if (!terrain->chunks || !terrain->xs || !terrain->zs || !terrain->loads ||
+        !terrain->meshes || !terrain->skips || !terrain->lows || !terrain->highs ||
+        !terrain->sizes || !terrain->buckets || !terrain->capacities ||
+        !terrain->offsets || !terrain->indirects || !terrain->indices)
+    {
+        SDL_Log("Failed to allocate chunks");
+        return false;
+    }
+    memset(terrain->chunks, 0, count * sizeof(chunk_t));
+    for (int i = 0; i < count; i++)
+    {
+        chunk_clear(&terrain->chunks[i]);
+        terrain->xs[i] = INT_MAX;
+        terrain->zs[i] = INT_MAX;
+    }
+    return true;
 }
 
 void terrain_free(
     terrain_t* terrain)
 {
     assert(terrain);
-    for (int x = 0; x < WORLD_X; x++)
-    for (int z = 0; z < WORLD_Z; z++)
+    SDL_aligned_free(terrain->chunks);
+    free(terrain->xs);
+    free(terrain->zs);
+    free(terrain->loads);
+    free(terrain->meshes);
+    free(terrain->skips);
+    free(terrain->lows);
+    free(terrain->highs);
+    free(terrain->sizes);
+    free(terrain->buckets);
+    free(terrain->capacities);
+    free(terrain->offsets);
+    free(terrain->indirects);
+    free(terrain->indices);
+    memset(terrain, 0, sizeof(terrain_t));
+    while (pool.slabs)
     {
-        free(terrain->chunks[x][z]);
-        terrain->chunks[x][z] = NULL;
+        node_t* slab = pool.slabs;
+        pool.slabs = slab->next;
+        SDL_aligned_free(slab);
     }
+    mtx_destroy(&pool.mtx);
+    memset(&pool, 0, sizeof(pool));
 }
 
-chunk_t* terrain_get(
+int terrain_index(
     const terrain_t* terrain,
     const int x,
     const int z)
 {
     assert(terrain);
     assert(terrain_in(terrain, x, z));
-    assert(terrain->chunks[x][z]);
-    return terrain->chunks[x][z];
+    const int a = terrain->x + x;
+    const int b = terrain->z + z;
+    const int i = get_slot(terrain, a, b);
+    assert(terrain->xs[i] == a);
+    assert(terrain->zs[i] == b);
+    return i;
+}
+
+chunk_t* terrain_get(
+    const terrain_t* terrain,
+    const int x,
+    const int z)
+{
+    assert(terrain);
+    return &terrain->chunks[terrain_index(terrain, x, z)];
 }
 
 bool terrain_in(
@@ -104,8 +806,8 @@ bool terrain_in(
     return
         x >= 0 &&
         z >= 0 &&
-        x < WORLD_X &&
-        z < WORLD_Z;
+        x < terrain->width &&
+        z < terrain->depth;
 }
 
 bool terrain_border(
@@ -117,15 +819,15 @@ bool terrain_border(
     return
         x == 0 ||
         z == 0 ||
-        x == WORLD_X - 1 ||
-        z == WORLD_Z - 1;
+        x == terrain->width - 1 ||
+        z == terrain->depth - 1;
 }
 
 void terrain_neighbors(
-    terrain_t* terrain,
+    const terrain_t* terrain,
     const int x,
     const int z,
-    chunk_t* neighbors[DIRECTION_2])
+    int neighbors[DIRECTION_2])
 {
     assert(terrain);
     assert(terrain_in(terrain, x, z));
@@ -135,15 +837,49 @@ void terrain_neighbors(
         const int b = z + directions[d][2];
         if (terrain_in(terrain, a, b))
         {
-            neighbors[d] = terrain_get(terrain, a, b);
+            neighbors[d] = terrain_index(terrain, a, b);
+        }
+        else
+        {
+            neighbors[d] = -1;
+        }
+    }
+}
+
+void terrain_diagonals(
+    const terrain_t* terrain,
+    const int x,
+    const int z,
+    int neighbors[DIAGONAL_COUNT])
+{
+    assert(terrain);
+    assert(terrain_in(terrain, x, z));
+    for (diagonal_t d = 0; d < DIAGONAL_COUNT; d++)
+    {
+        const int a = x + diagonals[d][0];
+        const int b = z + diagonals[d][1];
+        if (terrain_in(terrain, a, b))
+        {
+            neighbors[d] = terrain_index(terrain, a, b);
         }
         else
         {
-            neighbors[d] = NULL;
+            neighbors[d] = -1;
         }
     }
 }
 
+int terrain_index2(
+    const terrain_t* terrain,
+    int x,
+    int z)
+{
+    assert(terrain);
+    x -= terrain->x;
+    z -= terrain->z;
+    return terrain_index(terrain, x, z);
+}
+
 chunk_t* terrain_get2(
     const terrain_t* terrain,
     int x,
@@ -178,10 +914,10 @@ bool terrain_border2(
 }
 
 void terrain_neighbors2(
-    terrain_t* terrain,
+    const terrain_t* terrain,
     int x,
     int z,
-    chunk_t* neighbors[DIRECTION_2])
+    int neighbors[DIRECTION_2])
 {
     assert(terrain);
     x -= terrain->x;
@@ -193,52 +929,57 @@ int* terrain_move(
     terrain_t* terrain,
     const int x,
     const int z,
+    const int width,
+    const int depth,
     int* size)
 {
     assert(terrain);
+    assert(width > 0 && width <= terrain->max_width);
+    assert(depth > 0 && depth <= terrain->max_depth);
     assert(size);
     *size = 0;
-    const int a = x - terrain->x;
-    const int b = z - terrain->z;
-    if (!a && !b)
+    if (x == terrain->x && z == terrain->z &&
+        width == terrain->width && depth == terrain->depth)
     {
         return NULL;
     }
-    terrain->x = x;
-    terrain->z = z;
-    chunk_t* in[WORLD_X][WORLD_Z] = {0};
-    chunk_t* out[WORLD_CHUNKS];
-    int* indices = malloc(WORLD_CHUNKS * 2 * sizeof(int));
-    assert(indices);
-    for (int i = 0; i < WORLD_X; i++)
-    for (int j = 0; j < WORLD_Z; j++)
+    if (terrain->x != INT_MAX)
     {
-        const int c = i - a;
-        const int d = j - b;
-        if (terrain_in(terrain, c, d))
+        for (int i = 0; i < terrain->width; i++)
+        for (int j = 0; j < terrain->depth; j++)
         {
-            in[c][d] = terrain_get(terrain, i, j);
+            const int a = terrain->x + i - x;
+            const int b = terrain->z + j - z;
+            if (a >= 0 && b >= 0 && a < width && b < depth)
+            {
+                continue;
+            }
+            const int k = terrain_index(terrain, i, j);
+            chunk_clear(&terrain->chunks[k]);
+            terrain->xs[k] = INT_MAX;
+            terrain->zs[k] = INT_MAX;
         }
-        else
-        {
-            out[(*size)++] = terrain_get(terrain, i, j);
-        }
-        terrain->chunks[i][j] = NULL;
     }
-    memcpy(terrain->chunks, in, sizeof(in));
-    int n = *size;
-    for (int i = 0; i < WORLD_X; i++)
-    for (int j = 0; j < WORLD_Z; j++)
+    terrain->x = x;
+    terrain->z = z;
+    terrain->width = width;
+    terrain->depth = depth;
+    int* indices = terrain->indices;
+    for (int i = 0; i < width; i++)
+    for (int j = 0; j < depth; j++)
     {
-        if (terrain->chunks[i][j])
+        const int a = x + i;
+        const int b = z + j;
+        const int k = get_slot(terrain, a, b);
+        if (terrain->xs[k] == a && terrain->zs[k] == b)
         {
             continue;
         }
-        --n;
-        terrain->chunks[i][j] = out[n];
-        indices[n * 2 + 0] = i;
-        indices[n * 2 + 1] = j;
+        terrain->xs[k] = a;
+        terrain->zs[k] = b;
+        indices[*size * 2 + 0] = i;
+        indices[*size * 2 + 1] = j;
+        (*size)++;
     }
-    assert(!n);
     return indices;
-}
\ No newline at end of file
+}
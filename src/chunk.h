@@ -2,6 +2,7 @@
 
 #include <SDL3/SDL.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "block.h"
 #include "helpers.h"
@@ -10,33 +11,95 @@ typedef enum
 {
     CHUNK_MESH_OPAQUE,
     CHUNK_MESH_TRANSPARENT,
+    CHUNK_MESH_SPRITE,
+    CHUNK_MESH_SHADOW,
     CHUNK_MESH_COUNT,
 }
 chunk_mesh_t;
 
+typedef enum
+{
+    CHUNK_MASK_OCCUPIED,
+    CHUNK_MASK_CUBE,
+    CHUNK_MASK_OPAQUE,
+    CHUNK_MASK_SOLID,
+    CHUNK_MASK_COUNT,
+}
+chunk_mask_t;
+
+#define CHUNK_ROW ((uint32_t) ((1ull << CHUNK_X) - 1))
+#define CHUNK_DIRTY ((uint32_t) ((1ull << CHUNK_SECTIONS) - 1))
+#define CHUNK_BUCKET_SPRITE DIRECTION_3
+#define CHUNK_BUCKETS (DIRECTION_3 + 1)
+
+typedef enum
+{
+    SECTION_TYPE_EMPTY,
+    SECTION_TYPE_UNIFORM,
+    SECTION_TYPE_MIXED,
+}
+section_type_t;
+
 typedef struct
 {
-    block_t blocks[CHUNK_X][CHUNK_Y][CHUNK_Z];
-    SDL_GPUBuffer* vbos[CHUNK_MESH_COUNT];
-    uint32_t sizes[CHUNK_MESH_COUNT];
-    uint32_t capacities[CHUNK_MESH_COUNT];
-    bool skip;
-    bool load;
-    bool mesh;
+    block_t palette[BLOCK_COUNT];
+    uint8_t lookup[BLOCK_COUNT];
+    uint8_t count;
+    uint8_t bits;
+    section_type_t type;
+    uint32_t* indices;
+    uint32_t* masks;
+}
+section_t;
+
+typedef struct
+{
+    section_t sections[CHUNK_SECTIONS];
+    uint8_t lows[CHUNK_X][CHUNK_Z];
+    uint8_t highs[CHUNK_X][CHUNK_Z];
+    int low;
+    int high;
 }
 chunk_t;
 
+typedef struct
+{
+    block_t blocks[CHUNK_X][CHUNK_Z][CHUNK_Y];
+}
+chunk_input_t;
+
 block_t chunk_get_block(
     const chunk_t* chunk,
     const int x,
     const int y,
     const int z);
+uint32_t chunk_get_mask(
+    const chunk_t* chunk,
+    const chunk_mask_t mask,
+    const int y,
+    const int z);
+void chunk_get_rows(
+    const chunk_t* chunk,
+    const chunk_mask_t mask,
+    const int y,
+    uint32_t rows[CHUNK_Z]);
 void chunk_set_block(
     chunk_t* chunk,
     const int x,
     const int y,
     const int z,
     const block_t block);
+void chunk_set_blocks(
+    chunk_t* chunk,
+    const chunk_input_t* input);
+void chunk_clear(
+    chunk_t* chunk);
+void chunk_compact(
+    chunk_t* chunk);
+size_t chunk_get_bytes(
+    const chunk_t* chunk);
+uint64_t chunk_hash(
+    const chunk_t* chunk);
 void chunk_wrap(
     int* x,
     int* y,
@@ -48,16 +111,40 @@ bool chunk_in(
 
 typedef struct
 {
-    chunk_t* chunks[WORLD_X][WORLD_Z];
+    chunk_t* chunks;
+    int* xs;
+    int* zs;
+    bool* loads;
+    uint32_t* meshes;
+    bool* skips;
+    uint8_t* lows;
+    uint8_t* highs;
+    uint32_t (*sizes)[CHUNK_SECTIONS][CHUNK_MESH_COUNT];
+    uint16_t (*buckets)[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS];
+    uint32_t (*capacities)[CHUNK_SECTIONS][CHUNK_MESH_COUNT];
+    uint32_t (*offsets)[CHUNK_SECTIONS][CHUNK_MESH_COUNT];
+    SDL_GPUBuffer** indirects;
+    int* indices;
     int x;
     int z;
+    int width;
+    int depth;
+    int max_width;
+    int max_depth;
+    int count;
 }
 terrain_t;
 
-void terrain_init(
-    terrain_t* terrain);
+bool terrain_init(
+    terrain_t* terrain,
+    const int width,
+    const int depth);
 void terrain_free(
     terrain_t* terrain);
+int terrain_index(
+    const terrain_t* terrain,
+    const int x,
+    const int z);
 chunk_t* terrain_get(
     const terrain_t* terrain,
     const int x,
@@ -71,10 +158,19 @@ bool terrain_border(
     const int x,
     const int z);
 void terrain_neighbors(
-    terrain_t* terrain,
+    const terrain_t* terrain,
     const int x,
     const int z,
-    chunk_t* neighbors[DIRECTION_2]);
+    int neighbors[DIRECTION_2]);
+void terrain_diagonals(
+    const terrain_t* terrain,
+    const int x,
+    const int z,
+    int neighbors[DIAGONAL_COUNT]);
+int terrain_index2(
+    const terrain_t* terrain,
+    int x,
+    int z);
 chunk_t* terrain_get2(
     const terrain_t* terrain,
     int x,
@@ -88,12 +184,14 @@ bool terrain_border2(
     int x,
     int z);
 void terrain_neighbors2(
-    terrain_t* terrain,
+    const terrain_t* terrain,
     int x,
     int z,
-    chunk_t* neighbors[DIRECTION_2]);
+    int neighbors[DIRECTION_2]);
 int* terrain_move(
     terrain_t* terrain,
     const int x,
     const int z,
+    const int width,
+    const int depth,
     int* size);
\ No newline at end of file
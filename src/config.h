@@ -24,23 +24,73 @@
 #define SHADOW_PITCH (-PI / 4.0f)
 #define SHADOW_YAW (PI / 8.0f)
 
-#define CHUNK_X 30
+#define CLOUD_Y 155.0
+#define CLOUD_EXTENT WORLD_FOG
+#define CLOUD_SCALE 0.015
+#define CLOUD_OCTAVES 6
+
+#ifndef CHUNK_X_BITS
+#define CHUNK_X_BITS 5
+#endif
+#ifndef CHUNK_Z_BITS
+#define CHUNK_Z_BITS 5
+#endif
+#define CHUNK_X (1 << CHUNK_X_BITS)
 #define CHUNK_Y 200
-#define CHUNK_Z 30
+#define CHUNK_Z (1 << CHUNK_Z_BITS)
+#define CHUNK_LAYOUT_LINEAR 0
+#define CHUNK_LAYOUT_TILED 1
+#define CHUNK_LAYOUT_MORTON 2
+#ifndef CHUNK_LAYOUT
+#define CHUNK_LAYOUT CHUNK_LAYOUT_LINEAR
+#endif
+#define SECTION_Y 8
+#define CHUNK_SECTIONS (CHUNK_Y / SECTION_Y)
 #define WORLD_X 20
 #define WORLD_Z 20
 #define WORLD_CHUNKS (WORLD_X * WORLD_Z)
+#define WORLD_DISTANCE 10
+#define WORLD_DISTANCE_MIN 3
+#define WORLD_DISTANCE_MAX 16
+#define WORLD_ADAPTIVE 1
+#define WORLD_BUDGET 20.0f
+#define WORLD_COOLDOWN 2000.0f
 #define WORLD_WORKERS 4
+#define WORLD_EDITS 8
+#define WORLD_PAGE 32
+#define WORLD_PAGES 131072
+#ifndef WORLD_LODS
+#define WORLD_LODS 2
+#endif
+#define WORLD_FOG (250.0f * (1 << WORLD_LODS))
 
 #define DATABASE_PATH "blocks.sqlite3"
 #define DATABASE_COOLDOWN 1000
 #define DATABASE_PLAYER 0
+#define DATABASE_LEGACY_X 30
+#define DATABASE_LEGACY_Z 30
+#define DATABASE_MESH_DISTANCE 64
 
-#define VOXEL_X_BITS 5
+#ifndef VOXEL_GREEDY
+#define VOXEL_GREEDY 1
+#endif
+#ifndef VOXEL_SIMD
+#define VOXEL_SIMD 1
+#endif
+#ifndef VOXEL_AO
+#define VOXEL_AO 1
+#endif
+#ifndef VOXEL_COMPUTE
+#define VOXEL_COMPUTE 0
+#endif
+#define VOXEL_SPRITE 6
+#define VOXEL_ARENA 4096
+#define VOXEL_VERSION 3
+#define VOXEL_X_BITS (CHUNK_X_BITS + 1)
 #define VOXEL_Y_BITS 8
-#define VOXEL_Z_BITS 5
+#define VOXEL_Z_BITS (CHUNK_Z_BITS + 1)
 #define VOXEL_U_BITS 4
-#define VOXEL_V_BITS 4
+#define VOXEL_V_BITS 3
 #define VOXEL_DIRECTION_BITS 3
 #define VOXEL_SHADOW_BITS 1
 #define VOXEL_SHADOWED_BITS 1
@@ -60,6 +110,18 @@
 #define VOXEL_DIRECTION_MASK ((1 << VOXEL_DIRECTION_BITS) - 1)
 #define VOXEL_SHADOW_MASK ((1 << VOXEL_SHADOW_BITS) - 1)
 #define VOXEL_SHADOWED_MASK ((1 << VOXEL_SHADOWED_BITS) - 1)
+#define VOXEL_EXTENT_X_BITS VOXEL_X_BITS
+#define VOXEL_EXTENT_Y_BITS VOXEL_Y_BITS
+#define VOXEL_EXTENT_Z_BITS VOXEL_Z_BITS
+#define VOXEL_AO_BITS 2
+#define VOXEL_EXTENT_X_OFFSET (0)
+#define VOXEL_EXTENT_Y_OFFSET (VOXEL_EXTENT_X_OFFSET + VOXEL_EXTENT_X_BITS)
+#define VOXEL_EXTENT_Z_OFFSET (VOXEL_EXTENT_Y_OFFSET + VOXEL_EXTENT_Y_BITS)
+#define VOXEL_AO_OFFSET (VOXEL_EXTENT_Z_OFFSET + VOXEL_EXTENT_Z_BITS)
+#define VOXEL_EXTENT_X_MASK ((1 << VOXEL_EXTENT_X_BITS) - 1)
+#define VOXEL_EXTENT_Y_MASK ((1 << VOXEL_EXTENT_Y_BITS) - 1)
+#define VOXEL_EXTENT_Z_MASK ((1 << VOXEL_EXTENT_Z_BITS) - 1)
+#define VOXEL_AO_MASK ((1 << VOXEL_AO_BITS) - 1)
 
 #define BUTTON_FORWARD SDL_SCANCODE_W
 #define BUTTON_BACKWARD SDL_SCANCODE_S
@@ -72,6 +134,8 @@
 #define BUTTON_BLOCK SDL_SCANCODE_B
 #define BUTTON_PAUSE SDL_SCANCODE_ESCAPE
 #define BUTTON_FULLSCREEN SDL_SCANCODE_F11
+#define BUTTON_FARTHER SDL_SCANCODE_EQUALS
+#define BUTTON_NEARER SDL_SCANCODE_MINUS
 #define BUTTON_PLACE SDL_BUTTON_RMASK
 #define BUTTON_BREAK SDL_BUTTON_LMASK
 
@@ -3,20 +3,70 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 // #include <threads.h>
 #include "tinycthread.h"
 #include "block.h"
 #include "database.h"
 #include "chunk.h"
 #include "helpers.h"
+#include "voxel.h"
 
 static sqlite3* handle;
 static sqlite3_stmt* set_player_stmt;
 static sqlite3_stmt* get_player_stmt;
 static sqlite3_stmt* set_block_stmt;
 static sqlite3_stmt* get_blocks_stmt;
+static sqlite3_stmt* set_mesh_stmt;
+static sqlite3_stmt* get_mesh_stmt;
+static sqlite3_stmt* prune_meshes_stmt;
 static mtx_t mtx;
 
+static bool migrate()
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, "PRAGMA user_version;", -1, &stmt, NULL))
+    {
+        return false;
+    }
+    int version = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    if (!version)
+    {
+        version = DATABASE_LEGACY_X << 16 | DATABASE_LEGACY_Z;
+    }
+    const int current = CHUNK_X << 16 | CHUNK_Z;
+    if (version == current)
+    {
+        return true;
+    }
+    const int x = version >> 16;
+    const int z = version & 0xFFFF;
+    char sql[1024];
+    SDL_snprintf(sql, sizeof(sql),
+        "BEGIN;"
+        "CREATE TEMP TABLE migrate AS "
+        "SELECT a * %d + x AS s, y, c * %d + z AS t, data FROM blocks;"
+        "DELETE FROM blocks;"
+        "INSERT INTO blocks (a, c, x, y, z, data) "
+        "SELECT s >> %d, t >> %d, s & %d, y, t & %d, data FROM migrate;"
+        "DROP TABLE migrate;"
+        "DELETE FROM meshes;"
+        "PRAGMA user_version = %d;"
+        "COMMIT;",
+        x, z, CHUNK_X_BITS, CHUNK_Z_BITS, CHUNK_X - 1, CHUNK_Z - 1, current);
+    if (sqlite3_exec(handle, sql, NULL, NULL, NULL))
+    {
+        sqlite3_exec(handle, "ROLLBACK;", NULL, NULL, NULL);
+        return false;
+    }
+    return true;
+}
+
 bool database_init(
     const char* file)
 {
@@ -45,6 +95,14 @@ bool database_init(
         "    data INTEGER NOT NULL,"
         "    PRIMARY KEY (a, c, x, y, z)"
         ");";
+    const char* meshes_table =
+        "CREATE TABLE IF NOT EXISTS meshes ("
+        "    a INTEGER NOT NULL,"
+        "    c INTEGER NOT NULL,"
+        "    hash INTEGER NOT NULL,"
+        "    data BLOB NOT NULL,"
+        "    PRIMARY KEY (a, c)"
+        ");";
     if (sqlite3_exec(handle, players_table, NULL, NULL, NULL))
     {
         SDL_Log("Failed to create players table: %s", sqlite3_errmsg(handle));
@@ -55,6 +113,16 @@ bool database_init(
         SDL_Log("Failed to create blocks table: %s", sqlite3_errmsg(handle));
         return false;
     }
+    if (sqlite3_exec(handle, meshes_table, NULL, NULL, NULL))
+    {
+        SDL_Log("Failed to create meshes table: %s", sqlite3_errmsg(handle));
+        return false;
+    }
+    if (!migrate())
+    {
+        SDL_Log("Failed to migrate blocks table: %s", sqlite3_errmsg(handle));
+        return false;
+    }
     const char* set_player =
         "INSERT OR REPLACE INTO players (id, x, y, z, pitch, yaw) "
         "VALUES (?, ?, ?, ?, ?, ?);";
@@ -67,6 +135,15 @@ bool database_init(
     const char* get_blocks =
         "SELECT x, y, z, data FROM blocks "
         "WHERE a = ? AND c = ?;";
+    const char* set_mesh =
+        "INSERT OR REPLACE INTO meshes (a, c, hash, data) "
+        "VALUES (?, ?, ?, ?);";
+    const char* get_mesh =
+        "SELECT data FROM meshes "
+        "WHERE a = ? AND c = ? AND hash = ?;";
+    const char* prune_meshes =
+        "DELETE FROM meshes "
+        "WHERE a < ? OR a > ? OR c < ? OR c > ?;";
     if (sqlite3_prepare_v2(handle, set_player, -1, &set_player_stmt, NULL))
     {
         SDL_Log("Failed to prepare set player: %s", sqlite3_errmsg(handle));
@@ -87,6 +164,21 @@ bool database_init(
         SDL_Log("Failed to prepare get blocks: %s", sqlite3_errmsg(handle));
         return false;
     }
+    if (sqlite3_prepare_v2(handle, set_mesh, -1, &set_mesh_stmt, NULL))
+    {
+        SDL_Log("Failed to prepare set mesh: %s", sqlite3_errmsg(handle));
+        return false;
+    }
+    if (sqlite3_prepare_v2(handle, get_mesh, -1, &get_mesh_stmt, NULL))
+    {
+        SDL_Log("Failed to prepare get mesh: %s", sqlite3_errmsg(handle));
+        return false;
+    }
+    if (sqlite3_prepare_v2(handle, prune_meshes, -1, &prune_meshes_stmt, NULL))
+    {
+        SDL_Log("Failed to prepare prune meshes: %s", sqlite3_errmsg(handle));
+        return false;
+    }
     const char* blocks_index =
         "CREATE INDEX IF NOT EXISTS blocks_index "
         "ON blocks (a, c);";
@@ -112,6 +204,9 @@ void database_free()
     sqlite3_finalize(get_player_stmt);
     sqlite3_finalize(set_block_stmt);
     sqlite3_finalize(get_blocks_stmt);
+    sqlite3_finalize(set_mesh_stmt);
+    sqlite3_finalize(get_mesh_stmt);
+    sqlite3_finalize(prune_meshes_stmt);
     sqlite3_close(handle);
 }
 
@@ -198,11 +293,11 @@ void database_set_block(
 }
 
 void database_get_blocks(
-    chunk_t* chunk,
+    chunk_input_t* input,
     const int a,
     const int c)
 {
-    assert(chunk);
+    assert(input);
     mtx_lock(&mtx);
     sqlite3_bind_int(get_blocks_stmt, 1, a);
     sqlite3_bind_int(get_blocks_stmt, 2, c);
@@ -212,8 +307,127 @@ void database_get_blocks(
         const int y = sqlite3_column_int(get_blocks_stmt, 1);
         const int z = sqlite3_column_int(get_blocks_stmt, 2);
         const block_t block = sqlite3_column_int(get_blocks_stmt, 3);
-        chunk_set_block(chunk, x, y, z, block);
+        assert(chunk_in(x, y, z));
+        input->blocks[x][z][y] = block;
     }
     sqlite3_reset(get_blocks_stmt);
     mtx_unlock(&mtx);
+}
+
+static uint32_t get_size(
+    const uint16_t buckets[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS],
+    const chunk_mesh_t mesh)
+{
+    uint32_t size = 0;
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+    for (int bucket = 0; bucket < CHUNK_BUCKETS; bucket++)
+    {
+        size += buckets[i][mesh][bucket];
+    }
+    return size;
+}
+
+void database_set_mesh(
+    const int a,
+    const int c,
+    const uint64_t hash,
+    const voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    const uint16_t buckets[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS])
+{
+    assert(arenas);
+    assert(buckets);
+    size_t size = CHUNK_SECTIONS * sizeof(buckets[0]);
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        assert(arenas[mesh].size == get_size(buckets, mesh));
+        size += arenas[mesh].size * 8;
+    }
+    uint8_t* data = malloc(size);
+    if (!data)
+    {
+        SDL_Log("Failed to allocate mesh");
+        return;
+    }
+    uint8_t* head = data;
+    memcpy(head, buckets, CHUNK_SECTIONS * sizeof(buckets[0]));
+    head += CHUNK_SECTIONS * sizeof(buckets[0]);
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        memcpy(head, arenas[mesh].data, arenas[mesh].size * 8);
+        head += arenas[mesh].size * 8;
+    }
+    mtx_lock(&mtx);
+    sqlite3_bind_int(set_mesh_stmt, 1, a);
+    sqlite3_bind_int(set_mesh_stmt, 2, c);
+    sqlite3_bind_int64(set_mesh_stmt, 3, (sqlite3_int64) hash);
+    sqlite3_bind_blob(set_mesh_stmt, 4, data, size, SQLITE_STATIC);
+    if (sqlite3_step(set_mesh_stmt) != SQLITE_DONE)
+    {
+        SDL_Log("Failed to set mesh: %s", sqlite3_errmsg(handle));
+    }
+    sqlite3_reset(set_mesh_stmt);
+    mtx_unlock(&mtx);
+    free(data);
+}
+
+bool database_get_mesh(
+    const int a,
+    const int c,
+    const uint64_t hash,
+    voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    uint16_t buckets[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS])
+{
+    assert(arenas);
+    assert(buckets);
+    mtx_lock(&mtx);
+    sqlite3_bind_int(get_mesh_stmt, 1, a);
+    sqlite3_bind_int(get_mesh_stmt, 2, c);
+    sqlite3_bind_int64(get_mesh_stmt, 3, (sqlite3_int64) hash);
+    bool mesh = sqlite3_step(get_mesh_stmt) == SQLITE_ROW;
+    if (mesh)
+    {
+        const uint8_t* data = sqlite3_column_blob(get_mesh_stmt, 0);
+        size_t size = sqlite3_column_bytes(get_mesh_stmt, 0);
+        mesh = size >= CHUNK_SECTIONS * sizeof(buckets[0]);
+        if (mesh)
+        {
+            memcpy(buckets, data, CHUNK_SECTIONS * sizeof(buckets[0]));
+            data += CHUNK_SECTIONS * sizeof(buckets[0]);
+            size -= CHUNK_SECTIONS * sizeof(buckets[0]);
+        }
+        for (chunk_mesh_t i = 0; mesh && i < CHUNK_MESH_COUNT; i++)
+        {
+            const uint32_t faces = get_size(buckets, i);
+            arenas[i].size = 0;
+            mesh = size >= faces * 8 && voxel_reserve(&arenas[i], faces);
+            if (mesh)
+            {
+                memcpy(arenas[i].data, data, faces * 8);
+                arenas[i].size = faces;
+                data += faces * 8;
+                size -= faces * 8;
+            }
+        }
+        mesh = mesh && !size;
+    }
+    sqlite3_reset(get_mesh_stmt);
+    mtx_unlock(&mtx);
+    return mesh;
+}
+
+void database_prune_meshes(
+    const int a,
+    const int c)
+{
+    mtx_lock(&mtx);
+    sqlite3_bind_int(prune_meshes_stmt, 1, a - DATABASE_MESH_DISTANCE);
+    sqlite3_bind_int(prune_meshes_stmt, 2, a + DATABASE_MESH_DISTANCE);
+    sqlite3_bind_int(prune_meshes_stmt, 3, c - DATABASE_MESH_DISTANCE);
+    sqlite3_bind_int(prune_meshes_stmt, 4, c + DATABASE_MESH_DISTANCE);
+    if (sqlite3_step(prune_meshes_stmt) != SQLITE_DONE)
+    {
+        SDL_Log("Failed to prune meshes: %s", sqlite3_errmsg(handle));
+    }
+    sqlite3_reset(prune_meshes_stmt);
+    mtx_unlock(&mtx);
 }
\ No newline at end of file
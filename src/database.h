@@ -5,6 +5,7 @@
 #include "chunk.h"
 #include "helpers.h"
 #include "noise.h"
+#include "voxel.h"
 
 bool database_init(
     const char* file);
@@ -32,6 +33,21 @@ void database_set_block(
     const int z,
     const block_t block);
 void database_get_blocks(
-    chunk_t* chunk,
+    chunk_input_t* input,
+    const int a,
+    const int c);
+void database_set_mesh(
+    const int a,
+    const int c,
+    const uint64_t hash,
+    const voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    const uint16_t buckets[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS]);
+bool database_get_mesh(
+    const int a,
+    const int c,
+    const uint64_t hash,
+    voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    uint16_t buckets[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS]);
+void database_prune_meshes(
     const int a,
     const int c);
\ No newline at end of file
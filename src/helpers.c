@@ -17,6 +17,14 @@ const int directions[][3] =
     [DIRECTION_D] = { 0,-1, 0 },
 };
 
+const int diagonals[][2] =
+{
+    [DIAGONAL_NE] = { 1, 1 },
+    [DIAGONAL_NW] = {-1, 1 },
+    [DIAGONAL_SE] = { 1,-1 },
+    [DIAGONAL_SW] = {-1,-1 },
+};
+
 static int cx;
 static int cz;
 
@@ -62,4 +70,27 @@ void sort_2d(
     cx = x;
     cz = z;
     qsort(data, size, 8, compare);
+}
+
+uint64_t hash_data(
+    const uint64_t hash,
+    const void* data,
+    size_t size)
+{
+    assert(data || !size);
+    const uint8_t* bytes = data;
+    uint64_t value = hash;
+    for (; size >= 8; size -= 8, bytes += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        value = (value ^ word) * 0x9E3779B97F4A7C15ull;
+        value ^= value >> 29;
+    }
+    for (; size; size--, bytes++)
+    {
+        value = (value ^ *bytes) * 0x9E3779B97F4A7C15ull;
+        value ^= value >> 29;
+    }
+    return value;
 }
\ No newline at end of file
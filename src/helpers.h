@@ -38,10 +38,25 @@ typedef enum
 }
 direction_t;
 
+typedef enum
+{
+    DIAGONAL_NE,
+    DIAGONAL_NW,
+    DIAGONAL_SE,
+    DIAGONAL_SW,
+    DIAGONAL_COUNT,
+}
+diagonal_t;
+
 extern const int directions[][3];
+extern const int diagonals[][2];
 
 void sort_2d(
     const int x,
     const int z,
     void* data,
-    const int size);
\ No newline at end of file
+    const int size);
+uint64_t hash_data(
+    const uint64_t hash,
+    const void* data,
+    size_t size);
\ No newline at end of file
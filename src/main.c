@@ -28,7 +28,9 @@ static SDL_GPUTexture* shadow_texture;
 static SDL_GPUTexture* position_texture;
 static SDL_GPUTexture* uv_texture;
 static SDL_GPUTexture* voxel_texture;
+#if !VOXEL_AO
 static SDL_GPUTexture* ssao_texture;
+#endif
 static SDL_GPUTexture* random_texture;
 static SDL_GPUTexture* atlas_texture;
 static SDL_GPUTexture* composite_texture;
@@ -193,6 +195,7 @@ static bool create_textures()
         SDL_Log("Failed to create voxel texture: %s", SDL_GetError());
         return false;
     }
+#if !VOXEL_AO
     tci.usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER;
     tci.format = SDL_GPU_TEXTUREFORMAT_R32_FLOAT;
     ssao_texture = SDL_CreateGPUTexture(device, &tci);
@@ -201,6 +204,7 @@ static bool create_textures()
         SDL_Log("Failed to create ssao texture: %s", SDL_GetError());
         return false;
     }
+#endif
     tci.usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER;
     tci.format = SDL_GPU_TEXTUREFORMAT_R32_FLOAT;
     random_texture = SDL_CreateGPUTexture(device, &tci);
@@ -385,8 +389,8 @@ static void draw_shadow()
         return;
     }
     pipeline_bind(pass, PIPELINE_SHADOW);
-    SDL_PushGPUVertexUniformData(commands, 1, shadow_camera.matrix, 64);
-    world_render(NULL, commands, pass, CHUNK_MESH_OPAQUE);
+    SDL_PushGPUVertexUniformData(commands, 0, shadow_camera.matrix, 64);
+    world_render(pass, CHUNK_MESH_SHADOW);
     SDL_EndGPURenderPass(pass);
 }
 
@@ -423,12 +427,23 @@ static void draw_opaque()
     tsb.texture = atlas_texture;
     pipeline_bind(pass, PIPELINE_OPAQUE);
     SDL_BindGPUFragmentSamplers(pass, 0, &tsb, 1);
+    SDL_PushGPUVertexUniformData(commands, 0, player_camera.view, 64);
+    SDL_PushGPUVertexUniformData(commands, 1, player_camera.proj, 64);
+    world_render(pass, CHUNK_MESH_OPAQUE);
+    pipeline_bind(pass, PIPELINE_SPRITE);
+    SDL_BindGPUFragmentSamplers(pass, 0, &tsb, 1);
+    SDL_PushGPUVertexUniformData(commands, 0, player_camera.view, 64);
+    SDL_PushGPUVertexUniformData(commands, 1, player_camera.proj, 64);
+    world_render(pass, CHUNK_MESH_SPRITE);
+    pipeline_bind(pass, PIPELINE_LOD);
+    SDL_BindGPUFragmentSamplers(pass, 0, &tsb, 1);
     SDL_PushGPUVertexUniformData(commands, 1, player_camera.view, 64);
     SDL_PushGPUVertexUniformData(commands, 2, player_camera.proj, 64);
-    world_render(&player_camera, commands, pass, CHUNK_MESH_OPAQUE);
+    world_render_lods(&player_camera, commands, pass);
     SDL_EndGPURenderPass(pass);
 }
 
+#if !VOXEL_AO
 static void draw_ssao()
 {
     SDL_GPUColorTargetInfo cti = {0};
@@ -456,6 +471,7 @@ static void draw_ssao()
     SDL_DrawGPUPrimitives(pass, 4, 1, 0, 0);
     SDL_EndGPURenderPass(pass);
 }
+#endif
 
 static void composite()
 {
@@ -482,12 +498,14 @@ static void composite()
     tsb[3].texture = voxel_texture;
     tsb[4].sampler = linear_sampler;
     tsb[4].texture = shadow_texture;
+#if !VOXEL_AO
     tsb[5].sampler = nearest_sampler;
     tsb[5].texture = ssao_texture;
+#endif
     camera_get_position(&player_camera, &position[0], &position[1], &position[2]);
     camera_vector(&shadow_camera, &vector[0], &vector[1], &vector[2]);
     pipeline_bind(pass, PIPELINE_COMPOSITE);
-    SDL_BindGPUFragmentSamplers(pass, 0, tsb, 6);
+    SDL_BindGPUFragmentSamplers(pass, 0, tsb, VOXEL_AO ? 5 : 6);
     SDL_PushGPUFragmentUniformData(commands, 0, position, 12);
     SDL_PushGPUFragmentUniformData(commands, 1, vector, 12);
     SDL_PushGPUFragmentUniformData(commands, 2, shadow_camera.matrix, 64);
@@ -523,13 +541,39 @@ static void draw_transparent()
     camera_get_position(&player_camera, &position[0], &position[1], &position[2]);
     camera_vector(&shadow_camera, &vector[0], &vector[1], &vector[2]);
     pipeline_bind(pass, PIPELINE_TRANSPARENT);
-    SDL_PushGPUVertexUniformData(commands, 1, player_camera.matrix, 64);
-    SDL_PushGPUVertexUniformData(commands, 2, position, 12);
-    SDL_PushGPUVertexUniformData(commands, 3, shadow_camera.matrix, 64);
+    SDL_PushGPUVertexUniformData(commands, 0, player_camera.matrix, 64);
+    SDL_PushGPUVertexUniformData(commands, 1, position, 12);
+    SDL_PushGPUVertexUniformData(commands, 2, shadow_camera.matrix, 64);
     SDL_PushGPUFragmentUniformData(commands, 0, vector, 12);
     SDL_PushGPUFragmentUniformData(commands, 1, position, 12);
     SDL_BindGPUFragmentSamplers(pass, 0, tsb, 3);
-    world_render(&player_camera, commands, pass, CHUNK_MESH_TRANSPARENT);
+    world_render(pass, CHUNK_MESH_TRANSPARENT);
+    SDL_EndGPURenderPass(pass);
+}
+
+static void draw_clouds()
+{
+    SDL_GPUColorTargetInfo cti = {0};
+    cti.load_op = SDL_GPU_LOADOP_LOAD;
+    cti.store_op = SDL_GPU_STOREOP_STORE;
+    cti.texture = composite_texture;
+    SDL_GPUDepthStencilTargetInfo dsti = {0};
+    dsti.load_op = SDL_GPU_LOADOP_LOAD;
+    dsti.store_op = SDL_GPU_STOREOP_STORE;
+    dsti.texture = depth_texture;
+    SDL_GPURenderPass* pass = SDL_BeginGPURenderPass(commands, &cti, 1, &dsti);
+    if (!pass)
+    {
+        SDL_Log("Failed to begin render pass: %s", SDL_GetError());
+        return;
+    }
+    float position[3];
+    camera_get_position(&player_camera, &position[0], &position[1], &position[2]);
+    pipeline_bind(pass, PIPELINE_CLOUD);
+    SDL_PushGPUVertexUniformData(commands, 0, player_camera.matrix, 64);
+    SDL_PushGPUVertexUniformData(commands, 1, position, 12);
+    SDL_PushGPUFragmentUniformData(commands, 0, position, 12);
+    SDL_DrawGPUPrimitives(pass, 6, 1, 0, 0);
     SDL_EndGPURenderPass(pass);
 }
 
@@ -647,6 +691,7 @@ static void draw()
     }
     camera_update(&player_camera);
     camera_update(&shadow_camera);
+    world_prepare(&player_camera, commands);
     SDL_PushGPUDebugGroup(commands, "sky");
     draw_sky();
     SDL_PopGPUDebugGroup(commands);
@@ -656,15 +701,20 @@ static void draw()
     SDL_PushGPUDebugGroup(commands, "opaque");
     draw_opaque();
     SDL_PopGPUDebugGroup(commands);
+#if !VOXEL_AO
     SDL_PushGPUDebugGroup(commands, "ssao");
     draw_ssao();
     SDL_PopGPUDebugGroup(commands);
+#endif
     SDL_PushGPUDebugGroup(commands, "composite");
     composite();
     SDL_PopGPUDebugGroup(commands);
     SDL_PushGPUDebugGroup(commands, "transparent");
     draw_transparent();
     SDL_PopGPUDebugGroup(commands);
+    SDL_PushGPUDebugGroup(commands, "clouds");
+    draw_clouds();
+    SDL_PopGPUDebugGroup(commands);
     SDL_PushGPUDebugGroup(commands, "raycast");
     draw_raycast();
     SDL_PopGPUDebugGroup(commands);
@@ -728,6 +778,14 @@ static bool poll()
                 selected = (selected + 1) % BLOCK_COUNT;
                 selected = clamp(selected, BLOCK_EMPTY + 1, BLOCK_COUNT - 1);
             }
+            else if (event.key.scancode == BUTTON_FARTHER)
+            {
+                world_set_distance(world_get_distance() + 1);
+            }
+            else if (event.key.scancode == BUTTON_NEARER)
+            {
+                world_set_distance(world_get_distance() - 1);
+            }
             else if (event.key.scancode == BUTTON_FULLSCREEN)
             {
                 if (SDL_GetWindowFlags(window) & SDL_WINDOW_FULLSCREEN)
@@ -859,7 +917,15 @@ int main(
         SDL_Log("Failed to create database");
         return EXIT_FAILURE;
     }
-    if (!world_init(device))
+    int distance = WORLD_DISTANCE_MAX;
+    for (int i = 1; i < argc - 1; i++)
+    {
+        if (!SDL_strcmp(argv[i], "--distance"))
+        {
+            distance = SDL_atoi(argv[++i]);
+        }
+    }
+    if (!world_init(device, distance))
     {
         SDL_Log("Failed to create world");
         return EXIT_FAILURE;
@@ -904,6 +970,10 @@ int main(
         }
         move(dt);
         camera_get_position(&player_camera, &x, &y, &z);
+        if (WORLD_ADAPTIVE)
+        {
+            world_adapt(dt);
+        }
         world_update(x, y, z);
         draw();
         if (cooldown++ > DATABASE_COOLDOWN)
@@ -921,7 +991,9 @@ int main(
     SDL_ReleaseGPUTexture(device, position_texture);
     SDL_ReleaseGPUTexture(device, uv_texture);
     SDL_ReleaseGPUTexture(device, voxel_texture);
+#if !VOXEL_AO
     SDL_ReleaseGPUTexture(device, ssao_texture);
+#endif
     SDL_ReleaseGPUTexture(device, random_texture);
     SDL_ReleaseGPUTexture(device, composite_texture);
     SDL_ReleaseGPUTexture(device, shadow_texture);
@@ -1,91 +1,107 @@
 #include <stb_perlin.h>
 #include <math.h>
+#include <string.h>
 #include "block.h"
 #include "chunk.h"
 #include "helpers.h"
 #include "noise.h"
 
-void noise_generate(
-    chunk_t* chunk,
-    const int x,
-    const int z)
+static float get_column(
+    const int s,
+    const int t,
+    block_t* top,
+    block_t* bottom,
+    bool* plants)
 {
-    for (int a = 0; a < CHUNK_X; a++)
-    for (int b = 0; b < CHUNK_Z; b++)
+    bool low = false;
+    bool grass = false;
+    float height = stb_perlin_fbm_noise3(
+        s * 0.005f,
+        0.0f,
+        t * 0.005f,
+        2.0f,
+        0.5f,
+        6);
+    height *= 50.0f;
+    height = powf(fmaxf(height, 0.0f), 1.3f);
+    height += 30;
+    height = clamp(height, 0, CHUNK_Y - 1);
+    if (height < 40)
     {
-        const int s = x * CHUNK_X + a;
-        const int t = z * CHUNK_Z + b;
-        bool low = false;
-        bool grass = false;
-        float height = stb_perlin_fbm_noise3(
-            s * 0.005f,
+        const float f = stb_perlin_fbm_noise3(
+            -s * 0.01f,
             0.0f,
-            t * 0.005f,
+            t * 0.01f,
             2.0f,
             0.5f,
             6);
-        height *= 50.0f;
-        height = powf(fmaxf(height, 0.0f), 1.3f);
-        height += 30;
-        height = clamp(height, 0, CHUNK_Y - 1);
-        if (height < 40)
+        height += f * 12.0f;
+        low = true;
+    }
+    float biome = stb_perlin_fbm_noise3(
+        s * 0.2f,
+        0.0f,
+        t * 0.2f,
+        2.0f,
+        0.5f,
+        6);
+    if (height + biome < 31)
+    {
+        *top = BLOCK_SAND;
+        *bottom = BLOCK_SAND;
+    }
+    else
+    {
+        biome *= 8.0f;
+        biome = clamp(biome, -5.0f, 5.0f);
+        if (height + biome < 61)
         {
-            const float f = stb_perlin_fbm_noise3(
-                -s * 0.01f,
-                0.0f,
-                t * 0.01f,
-                2.0f,
-                0.5f,
-                6);
-            height += f * 12.0f;
-            low = true;
+            *top = BLOCK_GRASS;
+            *bottom = BLOCK_DIRT;
+            grass = true;
         }
-        float biome = stb_perlin_fbm_noise3(
-            s * 0.2f,
-            0.0f,
-            t * 0.2f,
-            2.0f,
-            0.5f,
-            6);
-        block_t top;
-        block_t bottom;
-        if (height + biome < 31)
+        else if (height + biome < 132)
         {
-            top = BLOCK_SAND;
-            bottom = BLOCK_SAND;
+            *top = BLOCK_STONE;
+            *bottom = BLOCK_STONE;
         }
         else
         {
-            biome *= 8.0f;
-            biome = clamp(biome, -5.0f, 5.0f);
-            if (height + biome < 61)
-            {
-                top = BLOCK_GRASS;
-                bottom = BLOCK_DIRT;
-                grass = true;
-            }
-            else if (height + biome < 132)
-            {
-                top = BLOCK_STONE;
-                bottom = BLOCK_STONE;
-            }
-            else
-            {
-                top = BLOCK_SNOW;
-                bottom = BLOCK_STONE;
-            }
+            *top = BLOCK_SNOW;
+            *bottom = BLOCK_STONE;
         }
+    }
+    *plants = low && grass;
+    return height;
+}
+
+void noise_generate(
+    chunk_input_t* input,
+    const int x,
+    const int z)
+{
+    assert(input);
+    memset(input, 0, sizeof(*input));
+    for (int a = 0; a < CHUNK_X; a++)
+    for (int b = 0; b < CHUNK_Z; b++)
+    {
+        const int s = x * CHUNK_X + a;
+        const int t = z * CHUNK_Z + b;
+        block_t top;
+        block_t bottom;
+        bool plants;
+        const float height = get_column(s, t, &top, &bottom, &plants);
         int y = 0;
         for (; y < height; y++)
         {
-            chunk_set_block(chunk, a, y, b, bottom);
+            input->blocks[a][b][y] = bottom;
         }
-        chunk_set_block(chunk, a, y, b, top);
+        input->blocks[a][b][y] = top;
         for (; y < 30; y++)
         {
-            chunk_set_block(chunk, a, y, b, BLOCK_WATER);
+            input->blocks[a][b][y] = BLOCK_WATER;
         }
-        if (low && grass)
+        if (plants)
         {
             const float plant = stb_perlin_fbm_noise3(
                 s * 0.2f,
@@ -101,7 +117,7 @@ void noise_generate(
                 const int log = 3 + plant * 2.0f;
                 for (int dy = 0; dy < log; dy++)
                 {
-                    chunk_set_block(chunk, a, y + dy + 1, b, BLOCK_LOG);
+                    input->blocks[a][b][y + dy + 1] = BLOCK_LOG;
                 }
                 for (int dx = -1; dx <= 1; dx++)
                 for (int dz = -1; dz <= 1; dz++)
@@ -109,13 +125,13 @@ void noise_generate(
                 {
                     if (dx != 0 || dz != 0 || dy != 0)
                     {
-                        chunk_set_block(chunk, a + dx, y + log + dy, b + dz, BLOCK_LEAVES);
+                        input->blocks[a + dx][b + dz][y + log + dy] = BLOCK_LEAVES;
                     }
                 }
             }
             else if (plant > 0.55f)
             {
-                chunk_set_block(chunk, a, y + 1, b, BLOCK_BUSH);
+                input->blocks[a][b][y + 1] = BLOCK_BUSH;
             }
             else if (plant > 0.52f)
             {
@@ -127,36 +143,26 @@ void noise_generate(
                     BLOCK_LAVENDER,
                     BLOCK_ROSE,
                 };
-                chunk_set_block(chunk, a, y + 1, b, flowers[value]);
+                input->blocks[a][b][y + 1] = flowers[value];
             }
         }
-        if (height > 130)
-        {
-            continue;
-        }
-        const float cloud = stb_perlin_turbulence_noise3(
-            s * 0.015f,
-            0.0f,
-            t * 0.015f,
-            2.0f,
-            0.5f,
-            6);
-        int scale = -1;
-        if (cloud > 0.9f)
-        {
-            scale = 2;
-        }
-        else if (cloud > 0.7f)
-        {
-            scale = 1;
-        }
-        else if (cloud > 0.6)
-        {
-            scale = 0;
-        }
-        for (int y = -scale; y <= scale; y++)
-        {
-            chunk_set_block(chunk, a, 155 - y, b, BLOCK_CLOUD);
-        }
     }
+}
+
+block_t noise_surface(
+    const int x,
+    const int z,
+    int* y)
+{
+    assert(y);
+    block_t top;
+    block_t bottom;
+    bool plants;
+    *y = ceilf(get_column(x, z, &top, &bottom, &plants));
+    if (*y < 30)
+    {
+        *y = 29;
+        return BLOCK_WATER;
+    }
+    return top;
 }
\ No newline at end of file
@@ -3,6 +3,10 @@
 #include "chunk.h"
 
 void noise_generate(
-    chunk_t* chunk,
+    chunk_input_t* input,
     const int x,
-    const int z);
\ No newline at end of file
+    const int z);
+block_t noise_surface(
+    const int x,
+    const int z,
+    int* y);
\ No newline at end of file
@@ -8,11 +8,13 @@
 
 static SDL_GPUDevice* device;
 static SDL_GPUGraphicsPipeline* pipelines[PIPELINE_COUNT];
+static SDL_GPUComputePipeline* computes[PIPELINE_COMPUTE_COUNT];
 
 static SDL_GPUShader* load(
     const char* _file,
     const int uniforms,
-    const int samplers)
+    const int samplers,
+    const int buffers)
 {
 #ifdef __APPLE__
     char file[1024];
@@ -48,6 +50,7 @@ static SDL_GPUShader* load(
 #endif
     info.num_uniform_buffers = uniforms;
     info.num_samplers = samplers;
+    info.num_storage_buffers = buffers;
     SDL_GPUShader* shader = SDL_CreateGPUShader(device, &info);
     SDL_free(code);
     if (!shader)
@@ -63,8 +66,8 @@ static SDL_GPUGraphicsPipeline* load_sky(
 {
     SDL_GPUGraphicsPipelineCreateInfo info =
     {
-        .vertex_shader = load("sky.vert", 2, 0),
-        .fragment_shader = load("sky.frag", 0, 0),
+        .vertex_shader = load("sky.vert", 2, 0, 0),
+        .fragment_shader = load("sky.frag", 0, 0, 0),
         .target_info =
         {
             .num_color_targets = 1,
@@ -107,8 +110,8 @@ static SDL_GPUGraphicsPipeline* load_shadow(
 {
     SDL_GPUGraphicsPipelineCreateInfo info =
     {
-        .vertex_shader = load("shadow.vert", 2, 0),
-        .fragment_shader = load("shadow.frag", 0, 0),
+        .vertex_shader = load("shadow.vert", 1, 0, 1),
+        .fragment_shader = load("shadow.frag", 0, 0, 0),
         .target_info =
         {
             .has_depth_stencil_target = true,
@@ -119,13 +122,13 @@ static SDL_GPUGraphicsPipeline* load_shadow(
             .num_vertex_attributes = 1,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {{
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT2,
             }},
             .num_vertex_buffers = 1,
             .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
             {{
-                .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                .pitch = 4,
+                .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
+                .pitch = 8,
             }},
         },
         .depth_stencil_state =
@@ -154,8 +157,8 @@ static SDL_GPUGraphicsPipeline* load_opaque(
 {
     SDL_GPUGraphicsPipelineCreateInfo info =
     {
-        .vertex_shader = load("opaque.vert", 3, 0),
-        .fragment_shader = load("opaque.frag", 0, 1),
+        .vertex_shader = load("opaque.vert", 2, 0, 1),
+        .fragment_shader = load("opaque.frag", 0, 1, 0),
         .target_info =
         {
             .num_color_targets = 3,
@@ -177,13 +180,13 @@ static SDL_GPUGraphicsPipeline* load_opaque(
             .num_vertex_attributes = 1,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {{
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT2,
             }},
             .num_vertex_buffers = 1,
             .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
             {{
-                .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                .pitch = 4,
+                .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
+                .pitch = 8,
             }},
         },
         .depth_stencil_state =
@@ -212,13 +215,138 @@ static SDL_GPUGraphicsPipeline* load_opaque(
     return pipeline;
 }
 
+static SDL_GPUGraphicsPipeline* load_sprite(
+    const SDL_GPUTextureFormat format)
+{
+    SDL_GPUGraphicsPipelineCreateInfo info =
+    {
+        .vertex_shader = load("sprite.vert", 2, 0, 1),
+        .fragment_shader = load("opaque.frag", 0, 1, 0),
+        .target_info =
+        {
+            .num_color_targets = 3,
+            .color_target_descriptions = (SDL_GPUColorTargetDescription[])
+            {{
+                .format = SDL_GPU_TEXTUREFORMAT_R32G32B32A32_FLOAT,
+            },
+            {
+                .format = SDL_GPU_TEXTUREFORMAT_R32G32_FLOAT,
+            },
+            {
+                .format = SDL_GPU_TEXTUREFORMAT_R32_UINT,
+            }},
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D32_FLOAT,
+        },
+        .vertex_input_state =
+        {
+            .num_vertex_attributes = 1,
+            .vertex_attributes = (SDL_GPUVertexAttribute[])
+            {{
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT2,
+            }},
+            .num_vertex_buffers = 1,
+            .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
+            {{
+                .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
+                .pitch = 8,
+            }},
+        },
+        .depth_stencil_state =
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = true,
+            .compare_op = SDL_GPU_COMPAREOP_LESS,
+        },
+        .rasterizer_state =
+        {
+            .cull_mode = SDL_GPU_CULLMODE_NONE,
+        },
+    };
+    SDL_GPUGraphicsPipeline* pipeline = NULL;
+    if (info.vertex_shader && info.fragment_shader)
+    {
+        pipeline = SDL_CreateGPUGraphicsPipeline(device, &info);
+    }
+    if (!pipeline)
+    {
+        SDL_Log("Failed to create sprite pipeline: %s", SDL_GetError());
+    }
+    SDL_ReleaseGPUShader(device, info.vertex_shader);
+    SDL_ReleaseGPUShader(device, info.fragment_shader);
+    return pipeline;
+}
+
+static SDL_GPUGraphicsPipeline* load_lod(
+    const SDL_GPUTextureFormat format)
+{
+    SDL_GPUGraphicsPipelineCreateInfo info =
+    {
+        .vertex_shader = load("lod.vert", 4, 0, 0),
+        .fragment_shader = load("lod.frag", 1, 1, 0),
+        .target_info =
+        {
+            .num_color_targets = 3,
+            .color_target_descriptions = (SDL_GPUColorTargetDescription[])
+            {{
+                .format = SDL_GPU_TEXTUREFORMAT_R32G32B32A32_FLOAT,
+            },
+            {
+                .format = SDL_GPU_TEXTUREFORMAT_R32G32_FLOAT,
+            },
+            {
+                .format = SDL_GPU_TEXTUREFORMAT_R32_UINT,
+            }},
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D32_FLOAT,
+        },
+        .vertex_input_state =
+        {
+            .num_vertex_attributes = 1,
+            .vertex_attributes = (SDL_GPUVertexAttribute[])
+            {{
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT2,
+            }},
+            .num_vertex_buffers = 1,
+            .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
+            {{
+                .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
+                .pitch = 8,
+            }},
+        },
+        .depth_stencil_state =
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = true,
+            .compare_op = SDL_GPU_COMPAREOP_LESS,
+        },
+        .rasterizer_state =
+        {
+            .cull_mode = SDL_GPU_CULLMODE_BACK,
+            .front_face = SDL_GPU_FRONTFACE_CLOCKWISE,
+        },
+    };
+    SDL_GPUGraphicsPipeline* pipeline = NULL;
+    if (info.vertex_shader && info.fragment_shader)
+    {
+        pipeline = SDL_CreateGPUGraphicsPipeline(device, &info);
+    }
+    if (!pipeline)
+    {
+        SDL_Log("Failed to create lod pipeline: %s", SDL_GetError());
+    }
+    SDL_ReleaseGPUShader(device, info.vertex_shader);
+    SDL_ReleaseGPUShader(device, info.fragment_shader);
+    return pipeline;
+}
+
 static SDL_GPUGraphicsPipeline* load_ssao(
     const SDL_GPUTextureFormat format)
 {
     SDL_GPUGraphicsPipelineCreateInfo info =
     {
-        .vertex_shader = load("fullscreen.vert", 0, 0),
-        .fragment_shader = load("ssao.frag", 0, 4),
+        .vertex_shader = load("fullscreen.vert", 0, 0, 0),
+        .fragment_shader = load("ssao.frag", 0, 4, 0),
         .target_info =
         {
             .num_color_targets = 1,
@@ -247,8 +375,8 @@ static SDL_GPUGraphicsPipeline* load_composite(
 {
     SDL_GPUGraphicsPipelineCreateInfo info =
     {
-        .vertex_shader = load("fullscreen.vert", 0, 0),
-        .fragment_shader = load("composite.frag", 3, 6),
+        .vertex_shader = load("fullscreen.vert", 0, 0, 0),
+        .fragment_shader = load("composite.frag", 3, VOXEL_AO ? 5 : 6, 0),
         .target_info =
         {
             .num_color_targets = 1,
@@ -277,8 +405,8 @@ static SDL_GPUGraphicsPipeline* load_transparent(
 {
     SDL_GPUGraphicsPipelineCreateInfo info =
     {
-        .vertex_shader = load("transparent.vert", 4, 0),
-        .fragment_shader = load("transparent.frag", 4, 3),
+        .vertex_shader = load("transparent.vert", 3, 0, 1),
+        .fragment_shader = load("transparent.frag", 4, 3, 0),
         .target_info =
         {
             .num_color_targets = 1,
@@ -304,13 +432,13 @@ static SDL_GPUGraphicsPipeline* load_transparent(
             .num_vertex_attributes = 1,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {{
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT2,
             }},
             .num_vertex_buffers = 1,
             .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
             {{
-                .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                .pitch = 4,
+                .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
+                .pitch = 8,
             }},
         },
         .depth_stencil_state =
@@ -334,13 +462,65 @@ static SDL_GPUGraphicsPipeline* load_transparent(
     return pipeline;
 }
 
+static SDL_GPUGraphicsPipeline* load_cloud(
+    const SDL_GPUTextureFormat format)
+{
+    SDL_GPUGraphicsPipelineCreateInfo info =
+    {
+        .vertex_shader = load("cloud.vert", 2, 0, 0),
+        .fragment_shader = load("cloud.frag", 1, 0, 0),
+        .target_info =
+        {
+            .num_color_targets = 1,
+            .color_target_descriptions = (SDL_GPUColorTargetDescription[])
+            {{
+                .format = SDL_GPU_TEXTUREFORMAT_R32G32B32A32_FLOAT,
+                .blend_state =
+                {
+                    .enable_blend = true,
+                    .src_alpha_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
+                    .dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                    .src_color_blendfactor = SDL_GPU_BLENDFACTOR_SRC_ALPHA,
+                    .dst_color_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                    .color_blend_op = SDL_GPU_BLENDOP_ADD,
+                    .alpha_blend_op = SDL_GPU_BLENDOP_ADD,
+                },
+            }},
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D32_FLOAT,
+        },
+        .depth_stencil_state =
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = false,
+            .compare_op = SDL_GPU_COMPAREOP_LESS,
+        },
+        .rasterizer_state =
+        {
+            .cull_mode = SDL_GPU_CULLMODE_NONE,
+        },
+    };
+    SDL_GPUGraphicsPipeline* pipeline = NULL;
+    if (info.vertex_shader && info.fragment_shader)
+    {
+        pipeline = SDL_CreateGPUGraphicsPipeline(device, &info);
+    }
+    if (!pipeline)
+    {
+        SDL_Log("Failed to create cloud pipeline: %s", SDL_GetError());
+    }
+    SDL_ReleaseGPUShader(device, info.vertex_shader);
+    SDL_ReleaseGPUShader(device, info.fragment_shader);
+    return pipeline;
+}
+
 static SDL_GPUGraphicsPipeline* load_raycast(
     const SDL_GPUTextureFormat format)
 {
     SDL_GPUGraphicsPipelineCreateInfo info =
     {
-        .vertex_shader = load("raycast.vert", 2, 0),
-        .fragment_shader = load("raycast.frag", 0, 0),
+        .vertex_shader = load("raycast.vert", 2, 0, 0),
+        .fragment_shader = load("raycast.frag", 0, 0, 0),
         .target_info =
         {
             .num_color_targets = 1,
@@ -401,8 +581,8 @@ static SDL_GPUGraphicsPipeline* load_ui(
 {
     SDL_GPUGraphicsPipelineCreateInfo info =
     {
-        .vertex_shader = load("fullscreen.vert", 0, 0),
-        .fragment_shader = load("ui.frag", 3, 1),
+        .vertex_shader = load("fullscreen.vert", 0, 0, 0),
+        .fragment_shader = load("ui.frag", 3, 1, 0),
         .target_info =
         {
             .num_color_targets = 1,
@@ -441,8 +621,8 @@ static SDL_GPUGraphicsPipeline* load_random(
 {
     SDL_GPUGraphicsPipelineCreateInfo info =
     {
-        .vertex_shader = load("fullscreen.vert", 0, 0),
-        .fragment_shader = load("random.frag", 0, 0),
+        .vertex_shader = load("fullscreen.vert", 0, 0, 0),
+        .fragment_shader = load("random.frag", 0, 0, 0),
         .target_info =
         {
             .num_color_targets = 1,
@@ -466,6 +646,61 @@ static SDL_GPUGraphicsPipeline* load_random(
     return pipeline;
 }
 
+static SDL_GPUComputePipeline* load_mesh()
+{
+#ifdef __APPLE__
+    const char* file = "mesh.comp.msl";
+#else
+    const char* file = "mesh.comp.spv";
+#endif
+    SDL_GPUComputePipelineCreateInfo info = {0};
+    void* code = SDL_LoadFile(file, &info.code_size);
+    if (!code)
+    {
+        SDL_Log("Failed to load %s shader: %s", file, SDL_GetError());
+        return NULL;
+    }
+    info.code = code;
+#if defined(__APPLE__)
+    info.format = SDL_GPU_SHADERFORMAT_MSL;
+    info.entrypoint = "main0";
+#else
+    info.format = SDL_GPU_SHADERFORMAT_SPIRV;
+    info.entrypoint = "main";
+#endif
+    info.num_readonly_storage_buffers = 1;
+    info.num_readwrite_storage_buffers = 2;
+    info.num_uniform_buffers = 1;
+    info.threadcount_x = CHUNK_X;
+    info.threadcount_y = 1;
+    info.threadcount_z = 1;
+    SDL_GPUComputePipeline* pipeline = SDL_CreateGPUComputePipeline(device, &info);
+    SDL_free(code);
+    if (!pipeline)
+    {
+        SDL_Log("Failed to create mesh pipeline: %s", SDL_GetError());
+        return NULL;
+    }
+    return pipeline;
+}
+
+bool pipeline_init_compute(
+    SDL_GPUDevice* handle)
+{
+    assert(handle);
+    device = handle;
+    computes[PIPELINE_COMPUTE_MESH] = load_mesh();
+    for (pipeline_compute_t pipeline = 0; pipeline < PIPELINE_COMPUTE_COUNT; pipeline++)
+    {
+        if (!computes[pipeline])
+        {
+            SDL_Log("Failed to load compute pipeline: %d", pipeline);
+            return false;
+        }
+    }
+    return true;
+}
+
 bool pipeline_init(
     SDL_GPUDevice* handle,
     const SDL_GPUTextureFormat format)
@@ -476,9 +711,12 @@ bool pipeline_init(
     pipelines[PIPELINE_SKY] = load_sky(format);
     pipelines[PIPELINE_SHADOW] = load_shadow(format);
     pipelines[PIPELINE_OPAQUE] = load_opaque(format);
+    pipelines[PIPELINE_SPRITE] = load_sprite(format);
+    pipelines[PIPELINE_LOD] = load_lod(format);
     pipelines[PIPELINE_SSAO] = load_ssao(format);
     pipelines[PIPELINE_COMPOSITE] = load_composite(format);
     pipelines[PIPELINE_TRANSPARENT] = load_transparent(format);
+    pipelines[PIPELINE_CLOUD] = load_cloud(format);
     pipelines[PIPELINE_RAYCAST] = load_raycast(format);
     pipelines[PIPELINE_UI] = load_ui(format);
     pipelines[PIPELINE_RANDOM] = load_random(format);
@@ -490,7 +728,11 @@ bool pipeline_init(
             return false;
         }
     }
+#if VOXEL_COMPUTE
+    return pipeline_init_compute(handle);
+#else
     return true;
+#endif
 }
 
 void pipeline_free()
@@ -503,6 +745,14 @@ void pipeline_free()
             pipelines[pipeline] = NULL;
         }
     }
+    for (pipeline_compute_t pipeline = 0; pipeline < PIPELINE_COMPUTE_COUNT; pipeline++)
+    {
+        if (computes[pipeline])
+        {
+            SDL_ReleaseGPUComputePipeline(device, computes[pipeline]);
+            computes[pipeline] = NULL;
+        }
+    }
     device = NULL;
 }
 
@@ -517,9 +767,12 @@ void pipeline_bind(
     case PIPELINE_SKY:
     case PIPELINE_SHADOW:
     case PIPELINE_OPAQUE:
+    case PIPELINE_SPRITE:
+    case PIPELINE_LOD:
     case PIPELINE_SSAO:
     case PIPELINE_COMPOSITE:
     case PIPELINE_TRANSPARENT:
+    case PIPELINE_CLOUD:
     case PIPELINE_RAYCAST:
     case PIPELINE_UI:
     case PIPELINE_RANDOM:
@@ -528,4 +781,14 @@ void pipeline_bind(
     default:
         assert(0);
     }
+}
+
+void pipeline_bind_compute(
+    SDL_GPUComputePass* pass,
+    const pipeline_compute_t pipeline)
+{
+    assert(pass);
+    assert(pipeline < PIPELINE_COMPUTE_COUNT);
+    assert(computes[pipeline]);
+    SDL_BindGPUComputePipeline(pass, computes[pipeline]);
 }
\ No newline at end of file
@@ -8,9 +8,12 @@ typedef enum
     PIPELINE_SKY,
     PIPELINE_SHADOW,
     PIPELINE_OPAQUE,
+    PIPELINE_SPRITE,
+    PIPELINE_LOD,
     PIPELINE_SSAO,
     PIPELINE_COMPOSITE,
     PIPELINE_TRANSPARENT,
+    PIPELINE_CLOUD,
     PIPELINE_RAYCAST,
     PIPELINE_UI,
     PIPELINE_RANDOM,
@@ -18,10 +21,22 @@ typedef enum
 }
 pipeline_t;
 
+typedef enum
+{
+    PIPELINE_COMPUTE_MESH,
+    PIPELINE_COMPUTE_COUNT
+}
+pipeline_compute_t;
+
 bool pipeline_init(
     SDL_GPUDevice* device,
     const SDL_GPUTextureFormat format);
+bool pipeline_init_compute(
+    SDL_GPUDevice* device);
 void pipeline_free();
 void pipeline_bind(
     void* pass,
-    const pipeline_t pipeline);
\ No newline at end of file
+    const pipeline_t pipeline);
+void pipeline_bind_compute(
+    SDL_GPUComputePass* pass,
+    const pipeline_compute_t pipeline);
\ No newline at end of file
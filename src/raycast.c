@@ -1,5 +1,5 @@
 #include <stdbool.h>
-#include "block.h"
+#include "chunk.h"
 #include "config.h"
 #include "helpers.h"
 #include "raycast.h"
@@ -32,7 +32,7 @@ bool raycast(
         {
             c -= 1.0f;
         }
-        if (block_solid(world_get_block(a, b, c)))
+        if (world_get_mask(a, b, c, CHUNK_MASK_SOLID))
         {
             if (previous)
             {
@@ -1,11 +1,21 @@
 #include <SDL3/SDL.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include "block.h"
 #include "helpers.h"
+#include "pipeline.h"
 #include "voxel.h"
 #include "world.h"
 
+#if VOXEL_LANES == 4
+#include <immintrin.h>
+#elif VOXEL_LANES == 2
+#include <emmintrin.h>
+#endif
+
 static uint32_t pack(
     const block_t block,
     const int x,
@@ -13,7 +23,7 @@ static uint32_t pack(
     const int z,
     const int u,
     const int v,
-    const direction_t direction)
+    const int direction)
 {
     static_assert(VOXEL_X_OFFSET + VOXEL_X_BITS <= 32, "");
     static_assert(VOXEL_Y_OFFSET + VOXEL_Y_BITS <= 32, "");
@@ -23,6 +33,14 @@ static uint32_t pack(
     static_assert(VOXEL_DIRECTION_OFFSET + VOXEL_DIRECTION_BITS <= 32, "");
     static_assert(VOXEL_SHADOW_OFFSET + VOXEL_SHADOW_BITS <= 32, "");
     static_assert(VOXEL_SHADOWED_OFFSET + VOXEL_SHADOWED_BITS <= 32, "");
+    static_assert(CHUNK_X <= VOXEL_X_MASK, "");
+    static_assert(CHUNK_Y <= VOXEL_Y_MASK, "");
+    static_assert(CHUNK_Z <= VOXEL_Z_MASK, "");
+    static_assert(VOXEL_SPRITE <= VOXEL_DIRECTION_MASK, "");
+    static_assert(CHUNK_X <= VOXEL_EXTENT_X_MASK, "");
+    static_assert(CHUNK_Y <= VOXEL_EXTENT_Y_MASK, "");
+    static_assert(CHUNK_Z <= VOXEL_EXTENT_Z_MASK, "");
+    static_assert(VOXEL_AO_OFFSET + VOXEL_AO_BITS * 4 <= 32, "");
     assert(x <= VOXEL_X_MASK);
     assert(y <= VOXEL_Y_MASK);
     assert(z <= VOXEL_Z_MASK);
@@ -41,300 +59,1089 @@ static uint32_t pack(
     return voxel;
 }
 
-static uint32_t pack_non_sprite(
+bool voxel_reserve(
+    voxel_arena_t* arena,
+    const uint32_t size)
+{
+    assert(arena);
+    if (arena->size + size <= arena->capacity)
+    {
+        return true;
+    }
+    uint32_t capacity = max(arena->capacity, VOXEL_ARENA);
+    while (capacity < arena->size + size)
+    {
+        capacity *= 2;
+    }
+    uint32_t* data = realloc(arena->data, capacity * 8);
+    if (!data)
+    {
+        SDL_Log("Failed to allocate arena");
+        return false;
+    }
+    arena->data = data;
+    arena->capacity = capacity;
+    return true;
+}
+
+static bool fill_sprite(
     const block_t block,
     const int x,
     const int y,
     const int z,
-    const direction_t direction,
-    const int i)
+    const int count,
+    voxel_arena_t* arena)
 {
     assert(block > BLOCK_EMPTY);
     assert(block < BLOCK_COUNT);
-    assert(direction < DIRECTION_3);
-    assert(i < 4);
-    static const int positions[][4][3] =
-    {
-        {{0, 0, 1}, {0, 1, 1}, {1, 0, 1}, {1, 1, 1}},
-        {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0}},
-        {{1, 0, 0}, {1, 0, 1}, {1, 1, 0}, {1, 1, 1}},
-        {{0, 0, 0}, {0, 1, 0}, {0, 0, 1}, {0, 1, 1}},
-        {{0, 1, 0}, {1, 1, 0}, {0, 1, 1}, {1, 1, 1}},
-        {{0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 0, 1}},
-    };
-    static const int uvs[][4][2] =
-    {
-        {{1, 1}, {1, 0}, {0, 1}, {0, 0}},
-        {{1, 1}, {0, 1}, {1, 0}, {0, 0}},
-        {{1, 1}, {0, 1}, {1, 0}, {0, 0}},
-        {{1, 1}, {1, 0}, {0, 1}, {0, 0}},
-        {{0, 0}, {1, 0}, {0, 1}, {1, 1}},
-        {{0, 0}, {0, 1}, {1, 0}, {1, 1}},
-    };
-    const int a = positions[direction][i][0] + x;
-    const int b = positions[direction][i][1] + y;
-    const int c = positions[direction][i][2] + z;
-    const int d = uvs[direction][i][0] + blocks[block][direction][0];
-    const int e = uvs[direction][i][1] + blocks[block][direction][1];
-    return pack(block, a, b, c, d, e, direction);
+    if (!(count & 1))
+    {
+        if (!voxel_reserve(arena, 1))
+        {
+            return false;
+        }
+        arena->data[arena->size * 2 + 1] = 0;
+        arena->size++;
+    }
+    const int u = blocks[block][DIRECTION_N][0];
+    const int v = blocks[block][DIRECTION_N][1];
+    arena->data[(arena->size - 1) * 2 + (count & 1)] = pack(block, x, y, z, u, v, VOXEL_SPRITE);
+    return true;
 }
 
-static uint32_t pack_sprite(
+static bool fill_non_sprite(
     const block_t block,
     const int x,
     const int y,
     const int z,
-    const int direction,
-    const int i)
+    const int extent[3],
+    const direction_t direction,
+    const uint32_t ao,
+    voxel_arena_t* arena)
 {
     assert(block > BLOCK_EMPTY);
     assert(block < BLOCK_COUNT);
-    assert(direction < 4);
-    assert(i < 4);
-    static const int positions[][4][3] =
-    {
-        {{0, 0, 0}, {0, 1, 0}, {1, 0, 1}, {1, 1, 1}},
-        {{0, 0, 0}, {1, 0, 1}, {0, 1, 0}, {1, 1, 1}},
-        {{0, 0, 1}, {1, 0, 0}, {0, 1, 1}, {1, 1, 0}},
-        {{0, 0, 1}, {0, 1, 1}, {1, 0, 0}, {1, 1, 0}},
-    };
-    static const int uvs[][4][2] =
+    assert(direction < DIRECTION_3);
+    if (!voxel_reserve(arena, 1))
     {
-        {{1, 1}, {1, 0}, {0, 1}, {0, 0}},
-        {{1, 1}, {0, 1}, {1, 0}, {0, 0}},
-        {{1, 1}, {0, 1}, {1, 0}, {0, 0}},
-        {{1, 1}, {1, 0}, {0, 1}, {0, 0}},
-    };
-    const int a = positions[direction][i][0] + x;
-    const int b = positions[direction][i][1] + y;
-    const int c = positions[direction][i][2] + z;
-    const int d = uvs[direction][i][0] + blocks[block][DIRECTION_N][0];
-    const int e = uvs[direction][i][1] + blocks[block][DIRECTION_N][1];
-    return pack(block, a, b, c, d, e, DIRECTION_U);
+        return false;
+    }
+    const int u = blocks[block][direction][0];
+    const int v = blocks[block][direction][1];
+    uint32_t* face = &arena->data[arena->size * 2];
+    face[0] = pack(block, x, y, z, u, v, direction);
+    face[1] = 0;
+    face[1] |= extent[0] << VOXEL_EXTENT_X_OFFSET;
+    face[1] |= extent[1] << VOXEL_EXTENT_Y_OFFSET;
+    face[1] |= extent[2] << VOXEL_EXTENT_Z_OFFSET;
+    face[1] |= ao << VOXEL_AO_OFFSET;
+    arena->size++;
+    return true;
+}
+
+static bool fill_shadow(
+    const int x,
+    const int y,
+    const int z,
+    const int extent[3],
+    const direction_t direction,
+    voxel_arena_t* arena)
+{
+    assert(direction < DIRECTION_3);
+    if (!voxel_reserve(arena, 1))
+    {
+        return false;
+    }
+    uint32_t* face = &arena->data[arena->size * 2];
+    face[0] = 0;
+    face[0] |= x << VOXEL_X_OFFSET;
+    face[0] |= y << VOXEL_Y_OFFSET;
+    face[0] |= z << VOXEL_Z_OFFSET;
+    face[0] |= direction << VOXEL_DIRECTION_OFFSET;
+    face[1] = 0;
+    face[1] |= extent[0] << VOXEL_EXTENT_X_OFFSET;
+    face[1] |= extent[1] << VOXEL_EXTENT_Y_OFFSET;
+    face[1] |= extent[2] << VOXEL_EXTENT_Z_OFFSET;
+    arena->size++;
+    return true;
+}
+
+static void copy_layer(
+    uint64_t plane[CHUNK_Y + 2][CHUNK_Z + 2],
+    const chunk_t* chunk,
+    const chunk_t* neighbors[DIRECTION_2],
+    const chunk_t* corners[DIAGONAL_COUNT],
+    const chunk_mask_t mask,
+    const int y)
+{
+    uint32_t rows[CHUNK_Z];
+    uint64_t* layer = plane[y + 1];
+    chunk_get_rows(chunk, mask, y, rows);
+    for (int z = 0; z < CHUNK_Z; z++)
+    {
+        layer[z + 1] = (uint64_t) rows[z] << 1;
+    }
+    layer[0] = 0;
+    layer[CHUNK_Z + 1] = 0;
+    if (!neighbors)
+    {
+        return;
+    }
+    if (neighbors[DIRECTION_N])
+    {
+        chunk_get_rows(neighbors[DIRECTION_N], mask, y, rows);
+        layer[CHUNK_Z + 1] = (uint64_t) rows[0] << 1;
+    }
+    if (neighbors[DIRECTION_S])
+    {
+        chunk_get_rows(neighbors[DIRECTION_S], mask, y, rows);
+        layer[0] = (uint64_t) rows[CHUNK_Z - 1] << 1;
+    }
+    if (neighbors[DIRECTION_E])
+    {
+        chunk_get_rows(neighbors[DIRECTION_E], mask, y, rows);
+        for (int z = 0; z < CHUNK_Z; z++)
+        {
+            layer[z + 1] |= (uint64_t) (rows[z] & 1) << (CHUNK_X + 1);
+        }
+    }
+    if (neighbors[DIRECTION_W])
+    {
+        chunk_get_rows(neighbors[DIRECTION_W], mask, y, rows);
+        for (int z = 0; z < CHUNK_Z; z++)
+        {
+            layer[z + 1] |= rows[z] >> (CHUNK_X - 1) & 1;
+        }
+    }
+    if (corners[DIAGONAL_NE])
+    {
+        const uint64_t row = chunk_get_mask(corners[DIAGONAL_NE], mask, y, 0);
+        layer[CHUNK_Z + 1] |= (row & 1) << (CHUNK_X + 1);
+    }
+    if (corners[DIAGONAL_NW])
+    {
+        const uint64_t row = chunk_get_mask(corners[DIAGONAL_NW], mask, y, 0);
+        layer[CHUNK_Z + 1] |= row >> (CHUNK_X - 1) & 1;
+    }
+    if (corners[DIAGONAL_SE])
+    {
+        const uint64_t row = chunk_get_mask(corners[DIAGONAL_SE], mask, y, CHUNK_Z - 1);
+        layer[0] |= (row & 1) << (CHUNK_X + 1);
+    }
+    if (corners[DIAGONAL_SW])
+    {
+        const uint64_t row = chunk_get_mask(corners[DIAGONAL_SW], mask, y, CHUNK_Z - 1);
+        layer[0] |= row >> (CHUNK_X - 1) & 1;
+    }
+}
+
+static void copy_halo(
+    voxel_input_t* input,
+    const chunk_t* chunk,
+    const chunk_t* neighbors[DIRECTION_2],
+    const chunk_t* corners[DIAGONAL_COUNT],
+    const int y)
+{
+    if (y < 0 || y >= CHUNK_Y)
+    {
+        memset(input->cubes[y + 1], 0, sizeof(input->cubes[0]));
+        memset(input->opaques[y + 1], 0, sizeof(input->opaques[0]));
+        return;
+    }
+    copy_layer(input->cubes, chunk, neighbors, corners, CHUNK_MASK_CUBE, y);
+    copy_layer(input->opaques, chunk, neighbors, corners, CHUNK_MASK_OPAQUE, y);
 }
 
-static void fill(
+void voxel_copy(
+    voxel_input_t* input,
     const chunk_t* chunk,
     const chunk_t* neighbors[DIRECTION_2],
-    uint32_t* datas[CHUNK_MESH_COUNT],
-    uint32_t sizes[CHUNK_MESH_COUNT],
-    const uint32_t capacities[CHUNK_MESH_COUNT])
+    const chunk_t* corners[DIAGONAL_COUNT])
 {
+    assert(input);
     assert(chunk);
-    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    static_assert(CHUNK_X + 2 <= 64, "");
+    input->low = chunk->low;
+    input->high = chunk->high;
+    if (input->low == input->high)
     {
-        sizes[mesh] = 0;
+        return;
     }
-    for (int x = 0; x < CHUNK_X; x++)
-    for (int y = 0; y < CHUNK_Y; y++)
+    copy_halo(input, chunk, neighbors, corners, input->low - 1);
+    copy_halo(input, chunk, neighbors, corners, input->high);
+    for (int y = input->low; y < input->high; y++)
+    {
+        copy_layer(input->occupied, chunk, NULL, NULL, CHUNK_MASK_OCCUPIED, y);
+        copy_layer(input->cubes, chunk, neighbors, corners, CHUNK_MASK_CUBE, y);
+        copy_layer(input->opaques, chunk, neighbors, corners, CHUNK_MASK_OPAQUE, y);
+    }
+}
+
+#if VOXEL_LANES == 4
+typedef __m256i lanes_t;
+
+static lanes_t lanes_load(
+    const uint64_t* data)
+{
+    return _mm256_loadu_si256((const __m256i*) data);
+}
+
+static void lanes_store(
+    uint64_t* data,
+    const lanes_t a)
+{
+    _mm256_storeu_si256((__m256i*) data, a);
+}
+
+static lanes_t lanes_and(
+    const lanes_t a,
+    const lanes_t b)
+{
+    return _mm256_and_si256(a, b);
+}
+
+static lanes_t lanes_or(
+    const lanes_t a,
+    const lanes_t b)
+{
+    return _mm256_or_si256(a, b);
+}
+
+static lanes_t lanes_andnot(
+    const lanes_t a,
+    const lanes_t b)
+{
+    return _mm256_andnot_si256(a, b);
+}
+
+static lanes_t lanes_left(
+    const lanes_t a)
+{
+    return _mm256_slli_epi64(a, 1);
+}
+
+static lanes_t lanes_right(
+    const lanes_t a)
+{
+    return _mm256_srli_epi64(a, 1);
+}
+#elif VOXEL_LANES == 2
+typedef __m128i lanes_t;
+
+static lanes_t lanes_load(
+    const uint64_t* data)
+{
+    return _mm_loadu_si128((const __m128i*) data);
+}
+
+static void lanes_store(
+    uint64_t* data,
+    const lanes_t a)
+{
+    _mm_storeu_si128((__m128i*) data, a);
+}
+
+static lanes_t lanes_and(
+    const lanes_t a,
+    const lanes_t b)
+{
+    return _mm_and_si128(a, b);
+}
+
+static lanes_t lanes_or(
+    const lanes_t a,
+    const lanes_t b)
+{
+    return _mm_or_si128(a, b);
+}
+
+static lanes_t lanes_andnot(
+    const lanes_t a,
+    const lanes_t b)
+{
+    return _mm_andnot_si128(a, b);
+}
+
+static lanes_t lanes_left(
+    const lanes_t a)
+{
+    return _mm_slli_epi64(a, 1);
+}
+
+static lanes_t lanes_right(
+    const lanes_t a)
+{
+    return _mm_srli_epi64(a, 1);
+}
+#else
+typedef uint64_t lanes_t;
+
+static lanes_t lanes_load(
+    const uint64_t* data)
+{
+    return *data;
+}
+
+static void lanes_store(
+    uint64_t* data,
+    const lanes_t a)
+{
+    *data = a;
+}
+
+static lanes_t lanes_and(
+    const lanes_t a,
+    const lanes_t b)
+{
+    return a & b;
+}
+
+static lanes_t lanes_or(
+    const lanes_t a,
+    const lanes_t b)
+{
+    return a | b;
+}
+
+static lanes_t lanes_andnot(
+    const lanes_t a,
+    const lanes_t b)
+{
+    return ~a & b;
+}
+
+static lanes_t lanes_left(
+    const lanes_t a)
+{
+    return a << 1;
+}
+
+static lanes_t lanes_right(
+    const lanes_t a)
+{
+    return a >> 1;
+}
+#endif
+
+static void get_faces(
+    const voxel_input_t* input,
+    const int y,
+    uint64_t faces[DIRECTION_3][CHUNK_Z])
+{
+    static_assert(CHUNK_Z % VOXEL_LANES == 0, "");
+    const int a = y + 1;
+    for (int z = 0; z < CHUNK_Z; z += VOXEL_LANES)
+    {
+        const int b = z + 1;
+        const lanes_t occupied = lanes_load(&input->occupied[a][b]);
+        const lanes_t cubes = lanes_load(&input->cubes[a][b]);
+        const lanes_t opaques = lanes_load(&input->opaques[a][b]);
+        const lanes_t transparents = lanes_andnot(opaques, cubes);
+        lanes_t covers[DIRECTION_3][2];
+        covers[DIRECTION_N][0] = lanes_load(&input->opaques[a][b + 1]);
+        covers[DIRECTION_N][1] = lanes_load(&input->cubes[a][b + 1]);
+        covers[DIRECTION_S][0] = lanes_load(&input->opaques[a][b - 1]);
+        covers[DIRECTION_S][1] = lanes_load(&input->cubes[a][b - 1]);
+        covers[DIRECTION_E][0] = lanes_right(opaques);
+        covers[DIRECTION_E][1] = lanes_right(cubes);
+        covers[DIRECTION_W][0] = lanes_left(opaques);
+        covers[DIRECTION_W][1] = lanes_left(cubes);
+        covers[DIRECTION_U][0] = lanes_load(&input->opaques[a + 1][b]);
+        covers[DIRECTION_U][1] = lanes_load(&input->cubes[a + 1][b]);
+        covers[DIRECTION_D][0] = lanes_load(&input->opaques[a - 1][b]);
+        covers[DIRECTION_D][1] = lanes_load(&input->cubes[a - 1][b]);
+        for (direction_t d = 0; d < DIRECTION_3; d++)
+        {
+            const lanes_t face = lanes_or(
+                lanes_andnot(covers[d][0], opaques),
+                lanes_andnot(covers[d][1], transparents));
+            lanes_store(&faces[d][z], lanes_right(lanes_and(face, occupied)));
+        }
+    }
+    if (y > 0)
+    {
+        return;
+    }
+    for (direction_t d = 0; d < DIRECTION_3; d++)
+    {
+        if (d != DIRECTION_U)
+        {
+            memset(faces[d], 0, sizeof(faces[d]));
+        }
+    }
+}
+
+static chunk_mesh_t get_mesh(
+    const voxel_input_t* input,
+    const int x,
+    const int y,
+    const int z)
+{
+    const uint64_t cubes = input->cubes[y + 1][z + 1];
+    const uint64_t opaques = input->opaques[y + 1][z + 1];
+    if ((cubes & ~opaques) >> (x + 1) & 1)
+    {
+        return CHUNK_MESH_TRANSPARENT;
+    }
+    else
+    {
+        return CHUNK_MESH_OPAQUE;
+    }
+}
+
+#if VOXEL_AO
+static bool is_opaque(
+    const voxel_input_t* input,
+    const int x,
+    const int y,
+    const int z)
+{
+    return input->opaques[y + 1][z + 1] >> (x + 1) & 1;
+}
+
+static uint32_t get_ao(
+    const voxel_input_t* input,
+    const int position[3],
+    const direction_t direction)
+{
+    static const int corners[DIRECTION_3][4][3] =
+    {
+        [DIRECTION_N] = {{0, 0, 1}, {0, 1, 1}, {1, 0, 1}, {1, 1, 1}},
+        [DIRECTION_S] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0}},
+        [DIRECTION_E] = {{1, 0, 0}, {1, 0, 1}, {1, 1, 0}, {1, 1, 1}},
+        [DIRECTION_W] = {{0, 0, 0}, {0, 1, 0}, {0, 0, 1}, {0, 1, 1}},
+        [DIRECTION_U] = {{0, 1, 0}, {1, 1, 0}, {0, 1, 1}, {1, 1, 1}},
+        [DIRECTION_D] = {{0, 0, 0}, {0, 0, 1}, {1, 0, 0}, {1, 0, 1}},
+    };
+    const int* normal = directions[direction];
+    const int x = position[0] + normal[0];
+    const int y = position[1] + normal[1];
+    const int z = position[2] + normal[2];
+    uint32_t ao = 0;
+    for (int corner = 0; corner < 4; corner++)
+    {
+        int sides[2][3] = {0};
+        int side = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (!normal[axis])
+            {
+                sides[side++][axis] = corners[direction][corner][axis] * 2 - 1;
+            }
+        }
+        const int a = is_opaque(input, x + sides[0][0], y + sides[0][1], z + sides[0][2]);
+        const int b = is_opaque(input, x + sides[1][0], y + sides[1][1], z + sides[1][2]);
+        const int c = is_opaque(input, x + sides[0][0] + sides[1][0],
+            y + sides[0][1] + sides[1][1], z + sides[0][2] + sides[1][2]);
+        const int value = a && b ? 0 : 3 - a - b - c;
+        ao |= value << (corner * VOXEL_AO_BITS);
+    }
+    return ao;
+}
+#else
+static uint32_t get_ao(
+    const voxel_input_t* input,
+    const int position[3],
+    const direction_t direction)
+{
+    return 0;
+}
+#endif
+
+static const int axes[][2] =
+{
+    [DIRECTION_N] = {0, 1},
+    [DIRECTION_S] = {0, 1},
+    [DIRECTION_E] = {2, 1},
+    [DIRECTION_W] = {2, 1},
+    [DIRECTION_U] = {0, 2},
+    [DIRECTION_D] = {0, 2},
+};
+
+static bool is_lit(
+    const direction_t direction)
+{
+    const float c = cosf(SHADOW_PITCH);
+    const float x = cosf(SHADOW_YAW - rad(90)) * c;
+    const float y = sinf(SHADOW_PITCH);
+    const float z = sinf(SHADOW_YAW - rad(90)) * c;
+    const int* normal = directions[direction];
+    return normal[0] * x + normal[1] * y + normal[2] * z < 0.0f;
+}
+
+static bool fill_shadows(
+    const voxel_input_t* input,
+    const chunk_t* chunk,
+    const int low,
+    const int high,
+    const direction_t direction,
+    voxel_arena_t* arena)
+{
+    const section_t* section = &chunk->sections[low / SECTION_Y];
+    bool casters = true;
+    for (int i = 0; i < section->count; i++)
+    {
+        const block_t block = section->palette[i];
+        if (block != BLOCK_EMPTY && !block_sprite(block) && !block_shadow(block))
+        {
+            casters = false;
+        }
+    }
+    uint64_t shadows[SECTION_Y][CHUNK_Z];
+    for (int y = low; y < high; y++)
+    for (int z = 0; z < CHUNK_Z; z++)
+    {
+        uint64_t faces = input->faces[y][direction][z] & input->opaques[y + 1][z + 1] >> 1;
+        for (int x = 0; !casters && faces >> x; x++)
+        {
+            if (faces >> x & 1 && !block_shadow(chunk_get_block(chunk, x, y, z)))
+            {
+                faces &= ~(1ull << x);
+            }
+        }
+        shadows[y - low][z] = faces;
+    }
+    const int s = axes[direction][0];
+    const int t = axes[direction][1];
+    const int limits[3] = {CHUNK_X, high, CHUNK_Z};
+    for (int y = low; y < high; y++)
+    for (int z = 0; z < CHUNK_Z; z++)
+    for (int x = 0; shadows[y - low][z] >> x; x++)
+    {
+        if (!(shadows[y - low][z] >> x & 1))
+        {
+            continue;
+        }
+        const int origin[3] = {x, y, z};
+        int extent[3] = {1, 1, 1};
+        int position[3] = {x, y, z};
+        for (position[s]++; position[s] < limits[s] &&
+            shadows[position[1] - low][position[2]] >> position[0] & 1; position[s]++)
+        {
+            extent[s]++;
+        }
+        while (origin[t] + extent[t] < limits[t])
+        {
+            position[t] = origin[t] + extent[t];
+            for (position[s] = origin[s]; position[s] < origin[s] + extent[s]; position[s]++)
+            {
+                if (!(shadows[position[1] - low][position[2]] >> position[0] & 1))
+                {
+                    break;
+                }
+            }
+            if (position[s] < origin[s] + extent[s])
+            {
+                break;
+            }
+            extent[t]++;
+        }
+        for (int i = 0; i < extent[t]; i++)
+        for (int j = 0; j < extent[s]; j++)
+        {
+            position[s] = origin[s] + j;
+            position[t] = origin[t] + i;
+            shadows[position[1] - low][position[2]] &= ~(1ull << position[0]);
+        }
+        if (!fill_shadow(x, y, z, extent, direction, arena))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool fill_sprites(
+    const voxel_input_t* input,
+    const chunk_t* chunk,
+    const int low,
+    const int high,
+    voxel_arena_t* arena)
+{
+    int count = 0;
+    for (int y = low; y < high; y++)
+    for (int z = 0; z < CHUNK_Z; z++)
+    {
+        uint64_t sprites = input->occupied[y + 1][z + 1] & ~input->cubes[y + 1][z + 1];
+        for (int x = 0; sprites >>= 1; x++)
+        {
+            if (sprites & 1)
+            {
+                const block_t block = chunk_get_block(chunk, x, y, z);
+                if (!fill_sprite(block, x, y, z, count++, arena))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#if !VOXEL_GREEDY
+static bool fill_direction(
+    voxel_input_t* input,
+    const chunk_t* chunk,
+    const int low,
+    const int high,
+    const direction_t direction,
+    voxel_arena_t arenas[CHUNK_MESH_COUNT])
+{
+    static const int extent[3] = {1, 1, 1};
+    for (int y = low; y < high; y++)
+    for (int z = 0; z < CHUNK_Z; z++)
+    {
+        uint64_t faces = input->faces[y][direction][z];
+        for (int x = 0; faces; x++, faces >>= 1)
+        {
+            if (!(faces & 1))
+            {
+                continue;
+            }
+            const block_t block = chunk_get_block(chunk, x, y, z);
+            const chunk_mesh_t mesh = get_mesh(input, x, y, z);
+            const int position[3] = {x, y, z};
+            const uint32_t ao = get_ao(input, position, direction);
+            if (!fill_non_sprite(block, x, y, z, extent, direction, ao, &arenas[mesh]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+#else
+static bool is_uniform(
+    const uint32_t ao)
+{
+    for (int corner = 1; corner < 4; corner++)
+    {
+        if ((ao >> (corner * VOXEL_AO_BITS) & VOXEL_AO_MASK) != (ao & VOXEL_AO_MASK))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool test(
+    const voxel_input_t* input,
+    const chunk_t* chunk,
+    const int high,
+    const block_t block,
+    const uint32_t ao,
+    const direction_t direction,
+    const int position[3])
+{
+    if (position[0] >= CHUNK_X || position[1] >= high || position[2] >= CHUNK_Z)
+    {
+        return false;
+    }
+    if (!(input->faces[position[1]][direction][position[2]] >> position[0] & 1))
+    {
+        return false;
+    }
+    if (chunk_get_block(chunk, position[0], position[1], position[2]) != block)
+    {
+        return false;
+    }
+    return get_ao(input, position, direction) == ao;
+}
+
+static bool fill_direction(
+    voxel_input_t* input,
+    const chunk_t* chunk,
+    const int low,
+    const int high,
+    const direction_t direction,
+    voxel_arena_t arenas[CHUNK_MESH_COUNT])
+{
+    const int d = direction;
+    const int s = axes[d][0];
+    const int t = axes[d][1];
+    for (int y = low; y < high; y++)
     for (int z = 0; z < CHUNK_Z; z++)
+    for (int x = 0; input->faces[y][d][z] >> x; x++)
     {
-        const block_t a = chunk->blocks[x][y][z];
-        if (a == BLOCK_EMPTY)
+        if (!(input->faces[y][d][z] >> x & 1))
         {
             continue;
         }
-        chunk_mesh_t mesh;
-        if (block_opaque(a))
-        {
-            mesh = CHUNK_MESH_OPAQUE;
-        }
-        else
-        {
-            mesh = CHUNK_MESH_TRANSPARENT;
-        }
-        if (block_sprite(a))
+        const block_t block = chunk_get_block(chunk, x, y, z);
+        const int origin[3] = {x, y, z};
+        const uint32_t ao = get_ao(input, origin, d);
+        int extent[3] = {1, 1, 1};
+        int position[3] = {x, y, z};
+        if (is_uniform(ao))
         {
-            sizes[mesh] += 4;
-            if (sizes[mesh] > capacities[mesh])
+            for (position[s]++; test(input, chunk, high, block, ao, d, position); position[s]++)
             {
-                continue;
+                extent[s]++;
             }
-            for (int direction = 0; direction < 4; direction++)
+            while (true)
             {
-                for (int i = 0; i < 4; i++)
+                position[t] = origin[t] + extent[t];
+                for (position[s] = origin[s]; position[s] < origin[s] + extent[s]; position[s]++)
+                {
+                    if (!test(input, chunk, high, block, ao, d, position))
+                    {
+                        break;
+                    }
+                }
+                if (position[s] < origin[s] + extent[s])
                 {
-                    const int j = sizes[mesh] * 4 - 4 * (direction + 1) + i;
-                    datas[mesh][j] = pack_sprite(a, x, y, z, direction, i);
-                }            
+                    break;
+                }
+                extent[t]++;
             }
-            continue;
         }
-        for (direction_t d = 0; d < DIRECTION_3; d++)
+        for (int i = 0; i < extent[t]; i++)
+        for (int j = 0; j < extent[s]; j++)
         {
-            if (y == 0 && d != DIRECTION_U)
-            {
-                continue;
-            }
-            block_t b;
-            int s = x + directions[d][0];
-            int t = y + directions[d][1];
-            int p = z + directions[d][2];
-            if (chunk_in(s, t, p))
-            {
-                b = chunk->blocks[s][t][p];
-            }
-            else if (d < DIRECTION_2 && neighbors[d])
-            {
-                chunk_wrap(&s, &t, &p);
-                b = neighbors[d]->blocks[s][t][p];
-            }
-            else
-            {
-                b = BLOCK_EMPTY;
-            }
-            if (b != BLOCK_EMPTY && !block_sprite(b) && !(block_opaque(a) && !block_opaque(b)))
+            position[s] = origin[s] + j;
+            position[t] = origin[t] + i;
+            input->faces[position[1]][d][position[2]] &= ~(1ull << position[0]);
+        }
+        const chunk_mesh_t mesh = get_mesh(input, x, y, z);
+        if (!fill_non_sprite(block, x, y, z, extent, d, ao, &arenas[mesh]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+static bool fill(
+    voxel_input_t* input,
+    const chunk_t* chunk,
+    const int low,
+    const int high,
+    voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    uint16_t buckets[CHUNK_MESH_COUNT][CHUNK_BUCKETS])
+{
+    static_assert(CHUNK_X * SECTION_Y * CHUNK_Z * 4 <= UINT16_MAX + 1, "");
+    for (int y = low; y < high; y++)
+    {
+        get_faces(input, y, input->faces[y]);
+    }
+    for (int bucket = 0; bucket < CHUNK_BUCKETS; bucket++)
+    {
+        uint32_t offsets[CHUNK_MESH_COUNT];
+        for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+        {
+            offsets[mesh] = arenas[mesh].size;
+        }
+        if (bucket == CHUNK_BUCKET_SPRITE)
+        {
+            if (!fill_sprites(input, chunk, low, high, &arenas[CHUNK_MESH_SPRITE]))
             {
-                continue;
+                return false;
             }
-            if (++sizes[mesh] > capacities[mesh])
+        }
+        else
+        {
+            if (is_lit(bucket) && !fill_shadows(input, chunk, low, high, bucket, &arenas[CHUNK_MESH_SHADOW]))
             {
-                continue;
+                return false;
             }
-            for (int i = 0; i < 4; i++)
+            if (!fill_direction(input, chunk, low, high, bucket, arenas))
             {
-                const int j = sizes[mesh] * 4 - 4 + i;
-                datas[mesh][j] = pack_non_sprite(a, x, y, z, d, i);    
+                return false;
             }
         }
+        for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+        {
+            assert(arenas[mesh].size - offsets[mesh] <= UINT16_MAX);
+            buckets[mesh][bucket] = arenas[mesh].size - offsets[mesh];
+        }
     }
+    return true;
 }
 
-bool voxel_vbo(
-    chunk_t* chunk,
-    const chunk_t* neighbors[DIRECTION_2],
-    SDL_GPUDevice* device,
-    SDL_GPUTransferBuffer* tbos[CHUNK_MESH_COUNT],
-    uint32_t capacities[CHUNK_MESH_COUNT])
+bool voxel_fill(
+    voxel_input_t* input,
+    const chunk_t* chunk,
+    const uint32_t sections,
+    voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    uint16_t buckets[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS])
 {
+    assert(input);
     assert(chunk);
-    assert(device);
-    uint32_t* datas[CHUNK_MESH_COUNT] = {0};
     for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
     {
-        if (!tbos[mesh])
+        arenas[mesh].size = 0;
+    }
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+    {
+        if (!(sections >> i & 1))
         {
             continue;
         }
-        datas[mesh] = SDL_MapGPUTransferBuffer(device, tbos[mesh], true);
-        if (!datas[mesh])
+        const int low = max(input->low, i * SECTION_Y);
+        const int high = min(input->high, (i + 1) * SECTION_Y);
+        if (low >= high)
+        {
+            memset(buckets[i], 0, sizeof(buckets[i]));
+        }
+        else if (!fill(input, chunk, low, high, arenas, buckets[i]))
         {
-            SDL_Log("Failed to map tbo buffer: %s", SDL_GetError());
             return false;
         }
     }
-    fill(
-        chunk,
-        neighbors,
-        datas,
-        chunk->sizes,
-        capacities);
+    return true;
+}
+
+void voxel_free(
+    voxel_arena_t arenas[CHUNK_MESH_COUNT])
+{
     for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
     {
-        if (datas[mesh])
-        {
-            SDL_UnmapGPUTransferBuffer(device, tbos[mesh]);
-            datas[mesh] = NULL;
-        }
+        free(arenas[mesh].data);
+        arenas[mesh].data = NULL;
+        arenas[mesh].size = 0;
+        arenas[mesh].capacity = 0;
     }
-    bool status = false;
-    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+}
+
+uint64_t voxel_hash(
+    const voxel_input_t* input,
+    const chunk_t* chunk)
+{
+    assert(input);
+    assert(chunk);
+    int lit = 0;
+    for (direction_t direction = 0; direction < DIRECTION_3; direction++)
     {
-        if (chunk->sizes[mesh])
-        {
-            status = true;
-            break;
-        }
+        lit |= is_lit(direction) << direction;
     }
-    if (!status)
+    const int config[] = {VOXEL_VERSION, VOXEL_GREEDY, VOXEL_AO, CHUNK_X, CHUNK_Y, CHUNK_Z, SECTION_Y, lit};
+    uint64_t hash = hash_data(chunk_hash(chunk), config, sizeof(config));
+    hash = hash_data(hash, blocks, BLOCK_COUNT * sizeof(blocks[0]));
+    if (input->low == input->high)
     {
-        return true;
+        return hash;
     }
-    status = false;
+    const int layers = input->high - input->low + 2;
+    hash = hash_data(hash, input->cubes[input->low], layers * sizeof(input->cubes[0]));
+    hash = hash_data(hash, input->opaques[input->low], layers * sizeof(input->opaques[0]));
+    return hash;
+}
+
+bool voxel_vbo(
+    const uint32_t sections,
+    const voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    const uint32_t sizes[CHUNK_SECTIONS][CHUNK_MESH_COUNT],
+    const uint32_t offsets[CHUNK_SECTIONS][CHUNK_MESH_COUNT],
+    const int32_t origin[2],
+    SDL_GPUDevice* device,
+    SDL_GPUTransferBuffer* tbos[CHUNK_MESH_COUNT],
+    uint32_t capacities[CHUNK_MESH_COUNT],
+    SDL_GPUBuffer* vbo,
+    SDL_GPUBuffer* pages)
+{
+    assert(device);
+    assert(vbo);
+    assert(pages);
+    static_assert(sizeof(int32_t[2]) == 8, "");
+    bool status = false;
     for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
     {
-        if (chunk->sizes[mesh] > capacities[mesh])
+        const uint32_t size = arenas[mesh].size;
+        if (!size)
         {
-            status = true;
-            break;
+            continue;
         }
-    }
-    if (status)
-    {
-        for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+        status = true;
+        const uint32_t capacity = size + size / WORLD_PAGE + CHUNK_SECTIONS;
+        if (capacity > capacities[mesh])
         {
-            if (chunk->sizes[mesh] <= capacities[mesh])
-            {
-                continue;
-            }
             if (tbos[mesh])
             {
                 SDL_ReleaseGPUTransferBuffer(device, tbos[mesh]);
                 tbos[mesh] = NULL;
                 capacities[mesh] = 0;
             }
+            const uint32_t reserve = arenas[mesh].capacity + arenas[mesh].capacity / WORLD_PAGE + CHUNK_SECTIONS;
             SDL_GPUTransferBufferCreateInfo tbci = {0};
             tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-            tbci.size = chunk->sizes[mesh] * 16;
+            tbci.size = reserve * 8;
             tbos[mesh] = SDL_CreateGPUTransferBuffer(device, &tbci);
             if (!tbos[mesh])
             {
                 SDL_Log("Failed to create tbo buffer: %s", SDL_GetError());
                 return false;
             }
-            capacities[mesh] = chunk->sizes[mesh];
+            capacities[mesh] = reserve;
         }
-        for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+        uint32_t* data = SDL_MapGPUTransferBuffer(device, tbos[mesh], true);
+        if (!data)
+        {
+            SDL_Log("Failed to map tbo buffer: %s", SDL_GetError());
+            return false;
+        }
+        memcpy(data, arenas[mesh].data, size * 8);
+        for (uint32_t i = size; i < capacity; i++)
+        {
+            memcpy(&data[i * 2], origin, 8);
+        }
+        SDL_UnmapGPUTransferBuffer(device, tbos[mesh]);
+    }
+    if (!status)
+    {
+        return true;
+    }
+    SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
+    if (!commands)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return false;
+    }
+    SDL_GPUCopyPass* pass = SDL_BeginGPUCopyPass(commands);
+    if (!pass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        return false;
+    }
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        if (!arenas[mesh].size)
+        {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (int i = 0; i < CHUNK_SECTIONS; i++)
         {
-            if (!chunk->sizes[mesh])
+            if (!(sections >> i & 1) || !sizes[i][mesh])
             {
                 continue;
             }
-            datas[mesh] = SDL_MapGPUTransferBuffer(device, tbos[mesh], true);
-            if (!datas[mesh])
-            {
-                SDL_Log("Failed to map tbo buffer: %s", SDL_GetError());
-                return false;
-            }
+            assert(offsets[i][mesh] % WORLD_PAGE == 0);
+            SDL_GPUTransferBufferLocation location = {0};
+            location.transfer_buffer = tbos[mesh];
+            location.offset = offset * 8;
+            SDL_GPUBufferRegion region = {0};
+            region.buffer = vbo;
+            region.offset = offsets[i][mesh] * 8;
+            region.size = sizes[i][mesh] * 8;
+            SDL_UploadToGPUBuffer(pass, &location, &region, false);
+            location.offset = arenas[mesh].size * 8;
+            region.buffer = pages;
+            region.offset = offsets[i][mesh] / WORLD_PAGE * 8;
+            region.size = (sizes[i][mesh] + WORLD_PAGE - 1) / WORLD_PAGE * 8;
+            SDL_UploadToGPUBuffer(pass, &location, &region, false);
+            offset += sizes[i][mesh];
         }
-        fill(
-            chunk,
-            neighbors,
-            datas,
-            chunk->sizes,
-            capacities);
-        for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    }
+    SDL_EndGPUCopyPass(pass);
+    SDL_SubmitGPUCommandBuffer(commands);
+    return true;
+}
+
+bool voxel_lod(
+    const uint8_t heights[CHUNK_X + 2][CHUNK_Z + 2],
+    const block_t blocks[CHUNK_X][CHUNK_Z],
+    voxel_arena_t* arena)
+{
+    assert(heights);
+    assert(blocks);
+    assert(arena);
+    arena->size = 0;
+    for (int z = 0; z < CHUNK_Z; z++)
+    for (int x = 0; x < CHUNK_X;)
+    {
+        const int height = heights[x + 1][z + 1];
+        const block_t block = blocks[x][z];
+        int extent[3] = {1, 1, 1};
+        while (x + extent[0] < CHUNK_X &&
+            heights[x + extent[0] + 1][z + 1] == height && blocks[x + extent[0]][z] == block)
+        {
+            extent[0]++;
+        }
+        if (!fill_non_sprite(block, x, height, z, extent, DIRECTION_U, 0, arena))
         {
-            if (datas[mesh])
+            return false;
+        }
+        for (int i = x; i < x + extent[0]; i++)
+        for (direction_t d = 0; d < DIRECTION_2; d++)
+        {
+            const int neighbor = heights[i + directions[d][0] + 1][z + directions[d][2] + 1];
+            if (neighbor >= height)
+            {
+                continue;
+            }
+            const int side[3] = {1, height - neighbor, 1};
+            if (!fill_non_sprite(block, i, neighbor + 1, z, side, d, 0, arena))
             {
-                SDL_UnmapGPUTransferBuffer(device, tbos[mesh]);
-                datas[mesh] = NULL;
+                return false;
             }
         }
+        x += extent[0];
     }
-    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    return true;
+}
+
+bool voxel_upload(
+    const voxel_arena_t* arena,
+    SDL_GPUDevice* device,
+    SDL_GPUTransferBuffer** tbo,
+    uint32_t* tbo_capacity,
+    SDL_GPUBuffer** vbo,
+    uint32_t* capacity)
+{
+    assert(arena);
+    assert(device);
+    const uint32_t size = arena->size;
+    if (!size)
+    {
+        return true;
+    }
+    if (size > *tbo_capacity)
     {
-        if (chunk->sizes[mesh] <= chunk->capacities[mesh])
+        if (*tbo)
         {
-            continue;
+            SDL_ReleaseGPUTransferBuffer(device, *tbo);
+            *tbo = NULL;
+            *tbo_capacity = 0;
+        }
+        SDL_GPUTransferBufferCreateInfo tbci = {0};
+        tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+        tbci.size = arena->capacity * 8;
+        *tbo = SDL_CreateGPUTransferBuffer(device, &tbci);
+        if (!*tbo)
+        {
+            SDL_Log("Failed to create tbo buffer: %s", SDL_GetError());
+            return false;
         }
-        if (chunk->vbos[mesh])
+        *tbo_capacity = arena->capacity;
+    }
+    if (size > *capacity)
+    {
+        if (*vbo)
         {
-            SDL_ReleaseGPUBuffer(device, chunk->vbos[mesh]);
-            chunk->vbos[mesh] = NULL;
-            chunk->capacities[mesh] = 0;
+            SDL_ReleaseGPUBuffer(device, *vbo);
+            *vbo = NULL;
+            *capacity = 0;
         }
         SDL_GPUBufferCreateInfo bci = {0};
         bci.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
-        bci.size = chunk->sizes[mesh] * 16;
-        chunk->vbos[mesh]= SDL_CreateGPUBuffer(device, &bci);
-        if (!chunk->vbos[mesh])
+        bci.size = size * 8;
+        *vbo = SDL_CreateGPUBuffer(device, &bci);
+        if (!*vbo)
         {
             SDL_Log("Failed to create vertex buffer: %s", SDL_GetError());
             return false;
         }
-        chunk->capacities[mesh] = chunk->sizes[mesh];
+        *capacity = size;
+    }
+    void* data = SDL_MapGPUTransferBuffer(device, *tbo, true);
+    if (!data)
+    {
+        SDL_Log("Failed to map tbo buffer: %s", SDL_GetError());
+        return false;
     }
+    memcpy(data, arena->data, size * 8);
+    SDL_UnmapGPUTransferBuffer(device, *tbo);
     SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
     if (!commands)
     {
@@ -348,85 +1155,300 @@ bool voxel_vbo(
         return false;
     }
     SDL_GPUTransferBufferLocation location = {0};
+    location.transfer_buffer = *tbo;
     SDL_GPUBufferRegion region = {0};
-    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    region.size = size * 8;
+    region.buffer = *vbo;
+    SDL_UploadToGPUBuffer(pass, &location, &region, 1);
+    SDL_EndGPUCopyPass(pass);
+    SDL_SubmitGPUCommandBuffer(commands);
+    return true;
+}
+
+#if VOXEL_COMPUTE
+static int count_bits(
+    uint64_t value)
+{
+    value -= value >> 1 & 0x5555555555555555ull;
+    value = (value & 0x3333333333333333ull) + (value >> 2 & 0x3333333333333333ull);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (value * 0x0101010101010101ull) >> 56;
+}
+
+void voxel_count(
+    const voxel_input_t* input,
+    uint32_t counts[CHUNK_MESH_COUNT])
+{
+    assert(input);
+    assert(counts);
+    memset(counts, 0, CHUNK_MESH_COUNT * sizeof(uint32_t));
+    uint32_t lit = 0;
+    for (direction_t direction = 0; direction < DIRECTION_3; direction++)
+    {
+        lit |= is_lit(direction) << direction;
+    }
+    const uint64_t inner = (uint64_t) CHUNK_ROW << 1;
+    for (int y = input->low; y < input->high; y++)
+    for (int z = 0; z < CHUNK_Z; z++)
     {
-        if (!chunk->sizes[mesh])
+        const int a = y + 1;
+        const int b = z + 1;
+        const uint64_t occupied = input->occupied[a][b] & inner;
+        const uint64_t cubes = input->cubes[a][b] & occupied;
+        const uint64_t opaques = input->opaques[a][b] & cubes;
+        const uint64_t transparents = cubes & ~opaques;
+        counts[CHUNK_MESH_SPRITE] += count_bits(occupied & ~cubes);
+        const uint64_t covers[DIRECTION_3][2] =
         {
-            continue;
+            [DIRECTION_N] = { input->opaques[a][b + 1], input->cubes[a][b + 1] },
+            [DIRECTION_S] = { input->opaques[a][b - 1], input->cubes[a][b - 1] },
+            [DIRECTION_E] = { input->opaques[a][b] >> 1, input->cubes[a][b] >> 1 },
+            [DIRECTION_W] = { input->opaques[a][b] << 1, input->cubes[a][b] << 1 },
+            [DIRECTION_U] = { input->opaques[a + 1][b], input->cubes[a + 1][b] },
+            [DIRECTION_D] = { input->opaques[a - 1][b], input->cubes[a - 1][b] },
+        };
+        for (direction_t direction = 0; direction < DIRECTION_3; direction++)
+        {
+            if (y == 0 && direction != DIRECTION_U)
+            {
+                continue;
+            }
+            const int faces = count_bits(opaques & ~covers[direction][0]);
+            counts[CHUNK_MESH_OPAQUE] += faces;
+            counts[CHUNK_MESH_TRANSPARENT] += count_bits(transparents & ~covers[direction][1]);
+            if (lit >> direction & 1)
+            {
+                counts[CHUNK_MESH_SHADOW] += faces;
+            }
         }
-        location.transfer_buffer = tbos[mesh];
-        region.size = chunk->sizes[mesh] * 16;
-        region.buffer = chunk->vbos[mesh];
-        SDL_UploadToGPUBuffer(pass, &location, &region, 1);
     }
-    SDL_EndGPUCopyPass(pass);
-    SDL_SubmitGPUCommandBuffer(commands);
-    return true;
 }
 
-bool voxel_ibo(
+static uint32_t get_compute(
+    const voxel_input_t* input,
+    const chunk_t* chunk,
+    uint32_t* data,
+    uint32_t* sections,
+    uint32_t* planes)
+{
+    static_assert(CHUNK_LAYOUT == CHUNK_LAYOUT_LINEAR, "");
+    static_assert(BLOCK_COUNT <= 16, "");
+    const int layers = input->high - input->low + 2;
+    const int rows = layers * (CHUNK_Z + 2);
+    *sections = BLOCK_COUNT * 8;
+    *planes = *sections + CHUNK_SECTIONS * 8;
+    uint32_t size = *planes + rows * 3 * 2;
+    if (data)
+    {
+        memset(data, 0, size * 4);
+        for (block_t block = BLOCK_EMPTY + 1; block < BLOCK_COUNT; block++)
+        {
+            for (direction_t direction = 0; direction < DIRECTION_3; direction++)
+            {
+                const int u = blocks[block][direction][0];
+                const int v = blocks[block][direction][1];
+                data[block * 8 + direction] = pack(block, 0, 0, 0, u, v, direction);
+            }
+            const int u = blocks[block][DIRECTION_N][0];
+            const int v = blocks[block][DIRECTION_N][1];
+            data[block * 8 + VOXEL_SPRITE] = pack(block, 0, 0, 0, u, v, VOXEL_SPRITE);
+        }
+        memcpy(data + *planes, input->occupied[input->low], rows * 8);
+        memcpy(data + *planes + rows * 2, input->cubes[input->low], rows * 8);
+        memcpy(data + *planes + rows * 4, input->opaques[input->low], rows * 8);
+    }
+    for (int i = input->low / SECTION_Y; i * SECTION_Y < input->high; i++)
+    {
+        const section_t* section = &chunk->sections[i];
+        const uint32_t words = (CHUNK_X * SECTION_Y * CHUNK_Z * section->bits + 31) / 32;
+        if (data)
+        {
+            uint32_t* header = data + *sections + i * 8;
+            header[0] = size;
+            header[1] = section->bits;
+            memcpy(&header[4], section->palette, section->count);
+        }
+        if (data && words)
+        {
+            memcpy(data + size, section->indices, words * 4);
+        }
+        size += words;
+    }
+    return size;
+}
+
+bool voxel_compute(
+    const voxel_input_t* input,
+    const chunk_t* chunk,
     SDL_GPUDevice* device,
-    SDL_GPUBuffer** ibo,
-    const uint32_t size)
+    SDL_GPUTransferBuffer** tbo,
+    uint32_t* tbo_capacity,
+    SDL_GPUBuffer** sbo,
+    uint32_t* sbo_capacity,
+    const uint32_t offsets[CHUNK_MESH_COUNT],
+    const uint32_t capacities[CHUNK_MESH_COUNT],
+    const int32_t origin[2],
+    SDL_GPUBuffer* vbo,
+    SDL_GPUBuffer* pages,
+    SDL_GPUBuffer** indirect)
 {
+    assert(input);
+    assert(chunk);
     assert(device);
-    assert(ibo);
-    assert(size);
-    SDL_GPUTransferBufferCreateInfo tbci = {0};
-    tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    tbci.size = size * 24;
-    SDL_GPUTransferBuffer* tbo = SDL_CreateGPUTransferBuffer(device, &tbci);
-    if (!tbo)
-    {
-        SDL_Log("Failed to create tbo buffer: %s", SDL_GetError());
-        return false;
+    assert(vbo);
+    assert(pages);
+    struct
+    {
+        uint32_t bases[CHUNK_MESH_COUNT];
+        uint32_t capacities[CHUNK_MESH_COUNT];
+        int32_t low;
+        int32_t high;
+        uint32_t lit;
+        uint32_t sections;
+        uint32_t planes;
     }
-    SDL_GPUBufferCreateInfo bci = {0};
-    bci.usage = SDL_GPU_BUFFERUSAGE_INDEX;
-    bci.size = size * 24;
-    *ibo = SDL_CreateGPUBuffer(device, &bci);
-    if (!(*ibo))
+    uniforms = {0};
+    memcpy(uniforms.bases, offsets, sizeof(uniforms.bases));
+    memcpy(uniforms.capacities, capacities, sizeof(uniforms.capacities));
+    uniforms.low = input->low;
+    uniforms.high = input->high;
+    for (direction_t direction = 0; direction < DIRECTION_3; direction++)
     {
-        SDL_Log("Failed to create index buffer: %s", SDL_GetError());
-        return false;
+        uniforms.lit |= is_lit(direction) << direction;
+    }
+    const uint32_t size = get_compute(input, chunk, NULL, &uniforms.sections, &uniforms.planes);
+    uint32_t count = 0;
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        assert(capacities[mesh] % WORLD_PAGE == 0);
+        count = max(count, capacities[mesh] / WORLD_PAGE);
+    }
+    const uint32_t faces = (size * 4 + sizeof(SDL_GPUIndirectDrawCommand) * CHUNK_MESH_COUNT + 7) / 8 + count;
+    if (faces > *tbo_capacity)
+    {
+        if (*tbo)
+        {
+            SDL_ReleaseGPUTransferBuffer(device, *tbo);
+            *tbo = NULL;
+            *tbo_capacity = 0;
+        }
+        SDL_GPUTransferBufferCreateInfo tbci = {0};
+        tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+        tbci.size = faces * 8;
+        *tbo = SDL_CreateGPUTransferBuffer(device, &tbci);
+        if (!*tbo)
+        {
+            SDL_Log("Failed to create tbo buffer: %s", SDL_GetError());
+            return false;
+        }
+        *tbo_capacity = faces;
+    }
+    if (size * 4 > *sbo_capacity)
+    {
+        if (*sbo)
+        {
+            SDL_ReleaseGPUBuffer(device, *sbo);
+            *sbo = NULL;
+            *sbo_capacity = 0;
+        }
+        SDL_GPUBufferCreateInfo bci = {0};
+        bci.usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ;
+        bci.size = size * 4;
+        *sbo = SDL_CreateGPUBuffer(device, &bci);
+        if (!*sbo)
+        {
+            SDL_Log("Failed to create storage buffer: %s", SDL_GetError());
+            return false;
+        }
+        *sbo_capacity = size * 4;
+    }
+    if (!*indirect)
+    {
+        SDL_GPUBufferCreateInfo bci = {0};
+        bci.usage = SDL_GPU_BUFFERUSAGE_INDIRECT | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+        bci.size = sizeof(SDL_GPUIndirectDrawCommand) * CHUNK_MESH_COUNT;
+        *indirect = SDL_CreateGPUBuffer(device, &bci);
+        if (!*indirect)
+        {
+            SDL_Log("Failed to create indirect buffer: %s", SDL_GetError());
+            return false;
+        }
     }
-    uint32_t* data = SDL_MapGPUTransferBuffer(device, tbo, false);
+    uint32_t* data = SDL_MapGPUTransferBuffer(device, *tbo, true);
     if (!data)
     {
         SDL_Log("Failed to map tbo buffer: %s", SDL_GetError());
         return false;
     }
-    for (uint32_t i = 0; i < size; i++)
+    get_compute(input, chunk, data, &uniforms.sections, &uniforms.planes);
+    SDL_GPUIndirectDrawCommand* commands = (SDL_GPUIndirectDrawCommand*) (data + size);
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
     {
-        data[i * 6 + 0] = i * 4 + 0;
-        data[i * 6 + 1] = i * 4 + 1;
-        data[i * 6 + 2] = i * 4 + 2;
-        data[i * 6 + 3] = i * 4 + 3;
-        data[i * 6 + 4] = i * 4 + 2;
-        data[i * 6 + 5] = i * 4 + 1;
+        commands[mesh] = (SDL_GPUIndirectDrawCommand) {0};
+        commands[mesh].num_vertices = mesh == CHUNK_MESH_SPRITE ? 24 : 6;
+        commands[mesh].first_instance = offsets[mesh];
     }
-    SDL_UnmapGPUTransferBuffer(device, tbo);
-    SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
-    if (!commands)
+    const uint32_t start = (size * 4 + sizeof(SDL_GPUIndirectDrawCommand) * CHUNK_MESH_COUNT + 7) / 8;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        memcpy(&data[(start + i) * 2], origin, 8);
+    }
+    SDL_UnmapGPUTransferBuffer(device, *tbo);
+    SDL_GPUCommandBuffer* command_buffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!command_buffer)
     {
         SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
         return false;
     }
-    SDL_GPUCopyPass* pass = SDL_BeginGPUCopyPass(commands);
-    if (!pass)
+    SDL_GPUCopyPass* copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+    if (!copy_pass)
     {
         SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(command_buffer);
         return false;
     }
     SDL_GPUTransferBufferLocation location = {0};
-    location.transfer_buffer = tbo;
+    location.transfer_buffer = *tbo;
     SDL_GPUBufferRegion region = {0};
-    region.size = size * 24;
-    region.buffer = *ibo;
-    SDL_UploadToGPUBuffer(pass, &location, &region, 1);
-    SDL_EndGPUCopyPass(pass);
-    SDL_SubmitGPUCommandBuffer(commands);
-    SDL_ReleaseGPUTransferBuffer(device, tbo);
+    region.buffer = *sbo;
+    region.size = size * 4;
+    SDL_UploadToGPUBuffer(copy_pass, &location, &region, true);
+    location.offset = size * 4;
+    region.buffer = *indirect;
+    region.size = sizeof(SDL_GPUIndirectDrawCommand) * CHUNK_MESH_COUNT;
+    SDL_UploadToGPUBuffer(copy_pass, &location, &region, true);
+    location.offset = start * 8;
+    region.buffer = pages;
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        if (!capacities[mesh])
+        {
+            continue;
+        }
+        region.offset = offsets[mesh] / WORLD_PAGE * 8;
+        region.size = capacities[mesh] / WORLD_PAGE * 8;
+        SDL_UploadToGPUBuffer(copy_pass, &location, &region, false);
+    }
+    SDL_EndGPUCopyPass(copy_pass);
+    if (input->low < input->high)
+    {
+        SDL_GPUStorageBufferReadWriteBinding bindings[2] = {0};
+        bindings[0].buffer = vbo;
+        bindings[1].buffer = *indirect;
+        SDL_GPUComputePass* compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, bindings, 2);
+        if (!compute_pass)
+        {
+            SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+            SDL_CancelGPUCommandBuffer(command_buffer);
+            return false;
+        }
+        pipeline_bind_compute(compute_pass, PIPELINE_COMPUTE_MESH);
+        SDL_BindGPUComputeStorageBuffers(compute_pass, 0, sbo, 1);
+        SDL_PushGPUComputeUniformData(command_buffer, 0, &uniforms, sizeof(uniforms));
+        SDL_DispatchGPUCompute(compute_pass, 1, input->high - input->low, CHUNK_Z);
+        SDL_EndGPUComputePass(compute_pass);
+    }
+    SDL_SubmitGPUCommandBuffer(command_buffer);
     return true;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
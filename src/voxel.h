@@ -6,13 +6,90 @@
 #include "chunk.h"
 #include "helpers.h"
 
-bool voxel_vbo(
-    chunk_t* chunk,
+#if VOXEL_SIMD && defined(__AVX2__)
+#define VOXEL_LANES 4
+#elif VOXEL_SIMD && (defined(__SSE2__) || defined(_M_X64))
+#define VOXEL_LANES 2
+#else
+#define VOXEL_LANES 1
+#endif
+
+typedef struct
+{
+    uint64_t occupied[CHUNK_Y + 2][CHUNK_Z + 2];
+    uint64_t cubes[CHUNK_Y + 2][CHUNK_Z + 2];
+    uint64_t opaques[CHUNK_Y + 2][CHUNK_Z + 2];
+    uint64_t faces[CHUNK_Y][DIRECTION_3][CHUNK_Z];
+    int low;
+    int high;
+}
+voxel_input_t;
+
+typedef struct
+{
+    uint32_t* data;
+    uint32_t size;
+    uint32_t capacity;
+}
+voxel_arena_t;
+
+void voxel_copy(
+    voxel_input_t* input,
+    const chunk_t* chunk,
     const chunk_t* neighbors[DIRECTION_2],
+    const chunk_t* corners[DIAGONAL_COUNT]);
+bool voxel_fill(
+    voxel_input_t* input,
+    const chunk_t* chunk,
+    const uint32_t sections,
+    voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    uint16_t buckets[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS]);
+bool voxel_reserve(
+    voxel_arena_t* arena,
+    const uint32_t size);
+void voxel_free(
+    voxel_arena_t arenas[CHUNK_MESH_COUNT]);
+uint64_t voxel_hash(
+    const voxel_input_t* input,
+    const chunk_t* chunk);
+bool voxel_vbo(
+    const uint32_t sections,
+    const voxel_arena_t arenas[CHUNK_MESH_COUNT],
+    const uint32_t sizes[CHUNK_SECTIONS][CHUNK_MESH_COUNT],
+    const uint32_t offsets[CHUNK_SECTIONS][CHUNK_MESH_COUNT],
+    const int32_t origin[2],
     SDL_GPUDevice* device,
     SDL_GPUTransferBuffer* tbos[CHUNK_MESH_COUNT],
-    uint32_t capacities[CHUNK_MESH_COUNT]);
-bool voxel_ibo(
+    uint32_t capacities[CHUNK_MESH_COUNT],
+    SDL_GPUBuffer* vbo,
+    SDL_GPUBuffer* pages);
+bool voxel_lod(
+    const uint8_t heights[CHUNK_X + 2][CHUNK_Z + 2],
+    const block_t blocks[CHUNK_X][CHUNK_Z],
+    voxel_arena_t* arena);
+bool voxel_upload(
+    const voxel_arena_t* arena,
+    SDL_GPUDevice* device,
+    SDL_GPUTransferBuffer** tbo,
+    uint32_t* tbo_capacity,
+    SDL_GPUBuffer** vbo,
+    uint32_t* capacity);
+#if VOXEL_COMPUTE
+void voxel_count(
+    const voxel_input_t* input,
+    uint32_t counts[CHUNK_MESH_COUNT]);
+bool voxel_compute(
+    const voxel_input_t* input,
+    const chunk_t* chunk,
     SDL_GPUDevice* device,
-    SDL_GPUBuffer** ibo,
-    const uint32_t size);
\ No newline at end of file
+    SDL_GPUTransferBuffer** tbo,
+    uint32_t* tbo_capacity,
+    SDL_GPUBuffer** sbo,
+    uint32_t* sbo_capacity,
+    const uint32_t offsets[CHUNK_MESH_COUNT],
+    const uint32_t capacities[CHUNK_MESH_COUNT],
+    const int32_t origin[2],
+    SDL_GPUBuffer* vbo,
+    SDL_GPUBuffer* pages,
+    SDL_GPUBuffer** indirect);
+#endif
\ No newline at end of file
@@ -1,5 +1,5 @@
 #include <SDL3/SDL.h>
-#include <math.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -21,6 +21,8 @@ typedef enum
     JOB_TYPE_QUIT,
     JOB_TYPE_LOAD,
     JOB_TYPE_MESH,
+    JOB_TYPE_LOD,
+    JOB_TYPE_PRUNE,
 }
 job_type_t;
 
@@ -29,9 +31,22 @@ typedef struct
     job_type_t type;
     int x;
     int z;
+    int level;
 }
 job_t;
 
+typedef struct
+{
+    int x;
+    int z;
+    bool loads;
+    uint8_t high;
+    uint32_t size;
+    uint32_t capacity;
+    SDL_GPUBuffer* vbo;
+}
+lod_t;
+
 typedef struct
 {
     thrd_t thrd;
@@ -40,15 +55,446 @@ typedef struct
     const job_t* job;
     SDL_GPUTransferBuffer* tbos[CHUNK_MESH_COUNT];
     uint32_t sizes[CHUNK_MESH_COUNT];
+    SDL_GPUBuffer* sbo;
+    uint32_t sbo_capacity;
+    voxel_arena_t arenas[CHUNK_MESH_COUNT];
+    voxel_input_t input;
+    uint16_t buckets[CHUNK_SECTIONS][CHUNK_MESH_COUNT][CHUNK_BUCKETS];
+    uint32_t faces[CHUNK_SECTIONS][CHUNK_MESH_COUNT];
+    uint32_t offsets[CHUNK_SECTIONS][CHUNK_MESH_COUNT];
+    uint32_t capacities[CHUNK_SECTIONS][CHUNK_MESH_COUNT];
+    uint8_t heights[CHUNK_X + 2][CHUNK_Z + 2];
+    block_t blocks[CHUNK_X][CHUNK_Z];
+    chunk_input_t chunk;
 }
 worker_t;
 
 static terrain_t terrain;
 static SDL_GPUDevice* device;
-static SDL_GPUBuffer* ibo;
-static uint32_t ibo_size;
 static worker_t workers[WORLD_WORKERS];
-static int sorted[WORLD_CHUNKS][2];
+static worker_t editor;
+static int edits[WORLD_EDITS][2];
+static int edit_count;
+static int (*sorted)[2];
+static lod_t lods[WORLD_LODS + 1][WORLD_X][WORLD_Z];
+static int lod_sorted[WORLD_CHUNKS][2];
+static int windows[WORLD_LODS + 1][2];
+static int distance;
+static int maximum;
+static int limit;
+static int prune_x;
+static int prune_z;
+static bool pruned;
+static bool grown;
+static bool busy;
+static float average;
+static float elapsed;
+static mtx_t mtx;
+static SDL_GPUBuffer* vbo;
+static SDL_GPUBuffer* pages;
+static uint64_t* used;
+static uint32_t page_count;
+static bool exhausted;
+static bool full;
+static SDL_GPUBuffer* draws;
+static SDL_GPUTransferBuffer* draw_tbo;
+static uint32_t firsts[CHUNK_MESH_COUNT];
+static uint32_t counts[CHUNK_MESH_COUNT];
+
+static bool acquire_pages(
+    const uint32_t size,
+    uint32_t* offset)
+{
+    const uint32_t count = (size + WORLD_PAGE - 1) / WORLD_PAGE;
+    uint32_t run = 0;
+    for (uint32_t page = 0; page < page_count; page++)
+    {
+        if (!(page & 63) && used[page / 64] == UINT64_MAX)
+        {
+            run = 0;
+            page += 63;
+            continue;
+        }
+        if (used[page / 64] >> (page & 63) & 1)
+        {
+            run = 0;
+            continue;
+        }
+        if (++run < count)
+        {
+            continue;
+        }
+        for (uint32_t i = page + 1 - count; i <= page; i++)
+        {
+            used[i / 64] |= 1ull << (i & 63);
+        }
+        *offset = (page + 1 - count) * WORLD_PAGE;
+        return true;
+    }
+    return false;
+}
+
+static void release_pages(
+    const uint32_t offset,
+    const uint32_t capacity)
+{
+    for (uint32_t i = offset / WORLD_PAGE; i < (offset + capacity) / WORLD_PAGE; i++)
+    {
+        used[i / 64] &= ~(1ull << (i & 63));
+    }
+}
+
+static bool grow()
+{
+    static_assert(WORLD_PAGES % 64 == 0, "");
+    const uint32_t count = page_count ? page_count * 2 : WORLD_PAGES;
+    uint64_t* bits = realloc(used, count / 64 * sizeof(uint64_t));
+    if (!bits)
+    {
+        SDL_Log("Failed to allocate page bitmap");
+        return false;
+    }
+    used = bits;
+    memset(&used[page_count / 64], 0, (count - page_count) / 64 * sizeof(uint64_t));
+    SDL_GPUBufferCreateInfo bci = {0};
+    bci.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
+#if VOXEL_COMPUTE
+    bci.usage |= SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+#endif
+    bci.size = count * WORLD_PAGE * 8;
+    SDL_GPUBuffer* faces = SDL_CreateGPUBuffer(device, &bci);
+    if (!faces)
+    {
+        SDL_Log("Failed to create vertex buffer: %s", SDL_GetError());
+        return false;
+    }
+    bci.usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ;
+    bci.size = count * 8;
+    SDL_GPUBuffer* origins = SDL_CreateGPUBuffer(device, &bci);
+    if (!origins)
+    {
+        SDL_Log("Failed to create page buffer: %s", SDL_GetError());
+        SDL_ReleaseGPUBuffer(device, faces);
+        return false;
+    }
+    if (page_count)
+    {
+        SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
+        if (!commands)
+        {
+            SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+            SDL_ReleaseGPUBuffer(device, faces);
+            SDL_ReleaseGPUBuffer(device, origins);
+            return false;
+        }
+        SDL_GPUCopyPass* pass = SDL_BeginGPUCopyPass(commands);
+        if (!pass)
+        {
+            SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+            SDL_CancelGPUCommandBuffer(commands);
+            SDL_ReleaseGPUBuffer(device, faces);
+            SDL_ReleaseGPUBuffer(device, origins);
+            return false;
+        }
+        SDL_GPUBufferLocation src = {0};
+        SDL_GPUBufferLocation dst = {0};
+        src.buffer = vbo;
+        dst.buffer = faces;
+        SDL_CopyGPUBufferToBuffer(pass, &src, &dst, page_count * WORLD_PAGE * 8, false);
+        src.buffer = pages;
+        dst.buffer = origins;
+        SDL_CopyGPUBufferToBuffer(pass, &src, &dst, page_count * 8, false);
+        SDL_EndGPUCopyPass(pass);
+        SDL_SubmitGPUCommandBuffer(commands);
+        SDL_ReleaseGPUBuffer(device, vbo);
+        SDL_ReleaseGPUBuffer(device, pages);
+    }
+    vbo = faces;
+    pages = origins;
+    page_count = count;
+    return true;
+}
+
+static bool reserve(
+    worker_t* worker,
+    const int section,
+    const chunk_mesh_t mesh,
+    const uint32_t size)
+{
+    uint32_t* capacity = &worker->capacities[section][mesh];
+    uint32_t* offset = &worker->offsets[section][mesh];
+    if (size <= *capacity)
+    {
+        return true;
+    }
+    mtx_lock(&mtx);
+    const bool status = acquire_pages(size, offset);
+    if (!status && !exhausted && !full)
+    {
+        SDL_Log("Failed to allocate %u faces, growing page pool", size);
+        exhausted = true;
+    }
+    mtx_unlock(&mtx);
+    if (!status)
+    {
+        return false;
+    }
+    *capacity = (size + WORLD_PAGE - 1) / WORLD_PAGE * WORLD_PAGE;
+    return true;
+}
+
+static void commit(
+    const worker_t* worker,
+    const int index,
+    const bool status)
+{
+    mtx_lock(&mtx);
+    for (int i = 0; i < CHUNK_SECTIONS; i++)
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        uint32_t* offset = &terrain.offsets[index][i][mesh];
+        uint32_t* capacity = &terrain.capacities[index][i][mesh];
+        if (worker->offsets[i][mesh] == *offset && worker->capacities[i][mesh] == *capacity)
+        {
+            continue;
+        }
+        if (status)
+        {
+            release_pages(*offset, *capacity);
+            *offset = worker->offsets[i][mesh];
+            *capacity = worker->capacities[i][mesh];
+        }
+        else
+        {
+            release_pages(worker->offsets[i][mesh], worker->capacities[i][mesh]);
+        }
+    }
+    if (status)
+    {
+        memcpy(terrain.buckets[index], worker->buckets, sizeof(worker->buckets));
+        memcpy(terrain.sizes[index], worker->faces, sizeof(worker->faces));
+    }
+    mtx_unlock(&mtx);
+}
+
+static void mesh(
+    worker_t* worker,
+    const int x,
+    const int z)
+{
+    const int i = terrain_index(&terrain, x, z);
+    assert(!terrain.skips[i]);
+    assert(!terrain.loads[i]);
+    assert(terrain.meshes[i]);
+    int indices[DIRECTION_2];
+    const chunk_t* neighbors[DIRECTION_2];
+    terrain_neighbors(&terrain, x, z, indices);
+    for (direction_t d = 0; d < DIRECTION_2; d++)
+    {
+        neighbors[d] = indices[d] >= 0 ? &terrain.chunks[indices[d]] : NULL;
+    }
+    int others[DIAGONAL_COUNT];
+    const chunk_t* corners[DIAGONAL_COUNT];
+    terrain_diagonals(&terrain, x, z, others);
+    for (diagonal_t d = 0; d < DIAGONAL_COUNT; d++)
+    {
+        corners[d] = others[d] >= 0 ? &terrain.chunks[others[d]] : NULL;
+    }
+    const chunk_t* chunk = &terrain.chunks[i];
+    const int a = terrain.x + x;
+    const int c = terrain.z + z;
+    const int32_t origin[2] = { a * CHUNK_X, c * CHUNK_Z };
+    voxel_copy(&worker->input, chunk, neighbors, corners);
+    memcpy(worker->buckets, terrain.buckets[i], sizeof(worker->buckets));
+    memcpy(worker->faces, terrain.sizes[i], sizeof(worker->faces));
+    memcpy(worker->offsets, terrain.offsets[i], sizeof(worker->offsets));
+    memcpy(worker->capacities, terrain.capacities[i], sizeof(worker->capacities));
+#if VOXEL_COMPUTE
+    uint32_t counts[CHUNK_MESH_COUNT];
+    voxel_count(&worker->input, counts);
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        if (!reserve(worker, 0, mesh, counts[mesh]))
+        {
+            commit(worker, i, false);
+            return;
+        }
+    }
+    if (!voxel_compute(
+        &worker->input,
+        chunk,
+        device,
+        &worker->tbos[CHUNK_MESH_OPAQUE],
+        &worker->sizes[CHUNK_MESH_OPAQUE],
+        &worker->sbo,
+        &worker->sbo_capacity,
+        worker->offsets[0],
+        worker->capacities[0],
+        origin,
+        vbo,
+        pages,
+        &terrain.indirects[i]))
+    {
+        commit(worker, i, false);
+        return;
+    }
+    commit(worker, i, true);
+    terrain.meshes[i] = 0;
+    return;
+#endif
+    if (terrain.meshes[i] == CHUNK_DIRTY)
+    {
+        const uint64_t hash = voxel_hash(&worker->input, chunk);
+        if (!database_get_mesh(a, c, hash, worker->arenas, worker->buckets))
+        {
+            if (!voxel_fill(&worker->input, chunk, CHUNK_DIRTY, worker->arenas, worker->buckets))
+            {
+                return;
+            }
+            database_set_mesh(a, c, hash, worker->arenas, worker->buckets);
+        }
+    }
+    else if (!voxel_fill(&worker->input, chunk, terrain.meshes[i], worker->arenas, worker->buckets))
+    {
+        return;
+    }
+    for (int k = 0; k < CHUNK_SECTIONS; k++)
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        if (!(terrain.meshes[i] >> k & 1))
+        {
+            continue;
+        }
+        worker->faces[k][mesh] = 0;
+        for (int bucket = 0; bucket < CHUNK_BUCKETS; bucket++)
+        {
+            worker->faces[k][mesh] += worker->buckets[k][mesh][bucket];
+        }
+        if (!reserve(worker, k, mesh, worker->faces[k][mesh]))
+        {
+            commit(worker, i, false);
+            return;
+        }
+    }
+    const bool status = voxel_vbo(
+        terrain.meshes[i],
+        worker->arenas,
+        worker->faces,
+        worker->offsets,
+        origin,
+        device,
+        worker->tbos,
+        worker->sizes,
+        vbo,
+        pages);
+    commit(worker, i, status);
+    if (status)
+    {
+        terrain.meshes[i] = 0;
+    }
+}
+
+static void load(
+    worker_t* worker,
+    const int x,
+    const int z)
+{
+    const int i = terrain_index(&terrain, x, z);
+    assert(terrain.loads[i]);
+    chunk_t* chunk = &terrain.chunks[i];
+    noise_generate(&worker->chunk, terrain.x + x, terrain.z + z);
+    database_get_blocks(&worker->chunk, terrain.x + x, terrain.z + z);
+    chunk_set_blocks(chunk, &worker->chunk);
+    terrain.lows[i] = chunk->low;
+    terrain.highs[i] = chunk->high;
+    terrain.skips[i] = false;
+    terrain.loads[i] = false;
+}
+
+static lod_t* get_lod(
+    const int level,
+    const int x,
+    const int z)
+{
+    return &lods[level][(x % WORLD_X + WORLD_X) % WORLD_X][(z % WORLD_Z + WORLD_Z) % WORLD_Z];
+}
+
+static void get_inner(
+    const int level,
+    int inner[4])
+{
+    if (level == 1)
+    {
+        inner[0] = terrain.x * CHUNK_X;
+        inner[1] = terrain.z * CHUNK_Z;
+        inner[2] = (terrain.x + terrain.width) * CHUNK_X;
+        inner[3] = (terrain.z + terrain.depth) * CHUNK_Z;
+        return;
+    }
+    const int width = CHUNK_X << (level - 1);
+    const int depth = CHUNK_Z << (level - 1);
+    inner[0] = windows[level - 1][0] * width;
+    inner[1] = windows[level - 1][1] * depth;
+    inner[2] = (windows[level - 1][0] + WORLD_X) * width;
+    inner[3] = (windows[level - 1][1] + WORLD_Z) * depth;
+}
+
+static bool is_hidden(
+    const int level,
+    const int x,
+    const int z)
+{
+    const int width = CHUNK_X << level;
+    const int depth = CHUNK_Z << level;
+    int inner[4];
+    get_inner(level, inner);
+    return x * width >= inner[0] && z * depth >= inner[1] &&
+        (x + 1) * width <= inner[2] && (z + 1) * depth <= inner[3];
+}
+
+static void load_lod(
+    worker_t* worker,
+    const int level,
+    const int x,
+    const int z)
+{
+    lod_t* lod = get_lod(level, x, z);
+    assert(lod->loads);
+    assert(lod->x == x && lod->z == z);
+    const int step = 1 << level;
+    const int s = x * (CHUNK_X << level);
+    const int t = z * (CHUNK_Z << level);
+    int high = 0;
+    for (int a = -1; a <= CHUNK_X; a++)
+    for (int b = -1; b <= CHUNK_Z; b++)
+    {
+        int y;
+        const block_t block = noise_surface(s + a * step, t + b * step, &y);
+        worker->heights[a + 1][b + 1] = y;
+        if (a >= 0 && b >= 0 && a < CHUNK_X && b < CHUNK_Z)
+        {
+            worker->blocks[a][b] = block;
+            high = max(high, y + 1);
+        }
+    }
+    voxel_arena_t* arena = &worker->arenas[CHUNK_MESH_OPAQUE];
+    if (!voxel_lod(worker->heights, worker->blocks, arena))
+    {
+        return;
+    }
+    if (voxel_upload(
+        arena,
+        device,
+        &worker->tbos[CHUNK_MESH_OPAQUE],
+        &worker->sizes[CHUNK_MESH_OPAQUE],
+        &lod->vbo,
+        &lod->capacity))
+    {
+        lod->size = arena->size;
+        lod->high = high;
+        lod->loads = false;
+    }
+}
 
 static int loop(
     void* args)
@@ -69,29 +515,19 @@ static int loop(
             mtx_unlock(&worker->mtx);
             return 0;
         }
-        const int x = terrain.x + worker->job->x;
-        const int z = terrain.z + worker->job->z;
-        chunk_t* chunk = terrain_get2(&terrain, x, z);
         switch (worker->job->type)
         {
         case JOB_TYPE_LOAD:
-            assert(chunk->load);
-            noise_generate(chunk, x, z);
-            database_get_blocks(chunk, x, z);
-            chunk->load = false;
+            load(worker, worker->job->x, worker->job->z);
             break;
         case JOB_TYPE_MESH:
-            assert(!chunk->skip);
-            assert(!chunk->load);
-            assert(chunk->mesh);
-            chunk_t* neighbors[DIRECTION_2];
-            terrain_neighbors2(&terrain, x, z, neighbors);
-            chunk->mesh = !voxel_vbo(
-                chunk,
-                neighbors,
-                device,
-                worker->tbos,
-                worker->sizes);
+            mesh(worker, worker->job->x, worker->job->z);
+            break;
+        case JOB_TYPE_LOD:
+            load_lod(worker, worker->job->level, worker->job->x, worker->job->z);
+            break;
+        case JOB_TYPE_PRUNE:
+            database_prune_meshes(worker->job->x, worker->job->z);
             break;
         default:
             assert(0);
@@ -129,11 +565,23 @@ static void wait_for_worker(
 }
 
 bool world_init(
-    SDL_GPUDevice* handle)
+    SDL_GPUDevice* handle,
+    const int value)
 {
     assert(handle);
     device = handle;
-    terrain_init(&terrain);
+    maximum = clamp(value, WORLD_DISTANCE_MIN, min(WORLD_X, WORLD_Z));
+    if (!terrain_init(&terrain, maximum * 2, maximum * 2))
+    {
+        SDL_Log("Failed to create terrain");
+        return false;
+    }
+    sorted = malloc(terrain.count * sizeof(*sorted));
+    if (!sorted)
+    {
+        SDL_Log("Failed to allocate sorted chunks");
+        return false;
+    }
     for (int i = 0; i < WORLD_WORKERS; i++)
     {
         worker_t* worker = &workers[i];
@@ -154,17 +602,61 @@ bool world_init(
             return false;
         }
     }
-    int i = 0;
+    memset(&editor, 0, sizeof(worker_t));
+    if (mtx_init(&mtx, mtx_plain) != thrd_success)
+    {
+        SDL_Log("Failed to create mutex");
+        return false;
+    }
+    page_count = 0;
+    exhausted = false;
+    full = false;
+    if (!grow())
+    {
+        return false;
+    }
+    SDL_GPUBufferCreateInfo bci = {0};
+    bci.usage = SDL_GPU_BUFFERUSAGE_INDIRECT;
+    bci.size = terrain.count * CHUNK_SECTIONS * CHUNK_BUCKETS * sizeof(SDL_GPUIndirectDrawCommand);
+    draws = SDL_CreateGPUBuffer(device, &bci);
+    if (!draws)
+    {
+        SDL_Log("Failed to create indirect buffer: %s", SDL_GetError());
+        return false;
+    }
+    SDL_GPUTransferBufferCreateInfo tbci = {0};
+    tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    tbci.size = bci.size;
+    draw_tbo = SDL_CreateGPUTransferBuffer(device, &tbci);
+    if (!draw_tbo)
+    {
+        SDL_Log("Failed to create tbo buffer: %s", SDL_GetError());
+        return false;
+    }
+    memset(counts, 0, sizeof(counts));
+    int n = 0;
     for (int x = 0; x < WORLD_X; x++)
     for (int z = 0; z < WORLD_Z; z++)
     {
-        sorted[i][0] = x;
-        sorted[i][1] = z;
-        i++;
+        lod_sorted[n][0] = x;
+        lod_sorted[n][1] = z;
+        n++;
+    }
+    sort_2d(WORLD_X / 2, WORLD_Z / 2, lod_sorted, n);
+    for (int level = 1; level <= WORLD_LODS; level++)
+    for (int x = 0; x < WORLD_X; x++)
+    for (int z = 0; z < WORLD_Z; z++)
+    {
+        lods[level][x][z].x = INT_MAX;
+        lods[level][x][z].z = INT_MAX;
     }
-    const int w = WORLD_X / 2;
-    const int h = WORLD_Z / 2;
-    sort_2d(w, h, sorted, WORLD_CHUNKS);
+    edit_count = 0;
+    pruned = false;
+    distance = clamp(WORLD_DISTANCE, WORLD_DISTANCE_MIN, maximum);
+    limit = maximum;
+    grown = false;
+    average = 0.0f;
+    elapsed = 0.0f;
     return true;
 }
 
@@ -178,20 +670,51 @@ void world_free()
         job.type = JOB_TYPE_QUIT;
         dispatch(worker, &job);
     }
+    if (vbo)
+    {
+        SDL_ReleaseGPUBuffer(device, vbo);
+        vbo = NULL;
+    }
+    if (pages)
+    {
+        SDL_ReleaseGPUBuffer(device, pages);
+        pages = NULL;
+    }
+    free(used);
+    used = NULL;
+    page_count = 0;
+    if (draws)
+    {
+        SDL_ReleaseGPUBuffer(device, draws);
+        draws = NULL;
+    }
+    if (draw_tbo)
+    {
+        SDL_ReleaseGPUTransferBuffer(device, draw_tbo);
+        draw_tbo = NULL;
+    }
+    for (int i = 0; i < terrain.count; i++)
+    {
+        if (terrain.indirects[i])
+        {
+            SDL_ReleaseGPUBuffer(device, terrain.indirects[i]);
+            terrain.indirects[i] = NULL;
+        }
+    }
+    for (int level = 1; level <= WORLD_LODS; level++)
     for (int x = 0; x < WORLD_X; x++)
     for (int z = 0; z < WORLD_Z; z++)
     {
-        chunk_t* chunk = terrain_get(&terrain, x, z);
-        for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+        lod_t* lod = &lods[level][x][z];
+        if (lod->vbo)
         {
-            if (chunk->vbos[mesh])
-            {
-                SDL_ReleaseGPUBuffer(device, chunk->vbos[mesh]);
-                chunk->vbos[mesh] = NULL;
-            }
+            SDL_ReleaseGPUBuffer(device, lod->vbo);
+            lod->vbo = NULL;
         }
     }
     terrain_free(&terrain);
+    free(sorted);
+    sorted = NULL;
     for (int i = 0; i < WORLD_WORKERS; i++)
     {
         worker_t* worker = &workers[i];
@@ -206,39 +729,162 @@ void world_free()
                 worker->tbos[mesh] = NULL;
             }
         }
+        if (worker->sbo)
+        {
+            SDL_ReleaseGPUBuffer(device, worker->sbo);
+            worker->sbo = NULL;
+        }
+        voxel_free(worker->arenas);
     }
-    if (ibo)
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
     {
-        SDL_ReleaseGPUBuffer(device, ibo);
-        ibo = NULL;
+        if (editor.tbos[mesh])
+        {
+            SDL_ReleaseGPUTransferBuffer(device, editor.tbos[mesh]);
+            editor.tbos[mesh] = NULL;
+        }
+    }
+    if (editor.sbo)
+    {
+        SDL_ReleaseGPUBuffer(device, editor.sbo);
+        editor.sbo = NULL;
     }
+    voxel_free(editor.arenas);
+    mtx_destroy(&mtx);
     device = NULL;
 }
 
+static void sort(
+    const int width,
+    const int depth)
+{
+    int i = 0;
+    for (int x = 0; x < width; x++)
+    for (int z = 0; z < depth; z++)
+    {
+        sorted[i][0] = x;
+        sorted[i][1] = z;
+        i++;
+    }
+    sort_2d(width / 2, depth / 2, sorted, i);
+}
+
+static bool contains(
+    const int x,
+    const int z,
+    const int width,
+    const int depth,
+    const int s,
+    const int t)
+{
+    return s >= x && t >= z && s < x + width && t < z + depth;
+}
+
 static void move(
     const int x,
     const int y,
     const int z)
 {
-    const int a = x / CHUNK_X - WORLD_X / 2;
-    const int c = z / CHUNK_Z - WORLD_Z / 2;
+    const int width = distance * 2;
+    const int depth = distance * 2;
+    if (width != terrain.width || depth != terrain.depth || terrain.x == INT_MAX)
+    {
+        sort(width, depth);
+    }
+    const int a = (x >> CHUNK_X_BITS) - width / 2;
+    const int c = (z >> CHUNK_Z_BITS) - depth / 2;
+    const int x1 = terrain.x;
+    const int z1 = terrain.z;
+    const int width1 = terrain.width;
+    const int depth1 = terrain.depth;
     int size;
-    int* data = terrain_move(&terrain, a, c, &size);
+    int* data = terrain_move(&terrain, a, c, width, depth, &size);
     if (!data)
     {
         return;
     }
     for (int i = 0; i < size; i++)
     {
-        const int j = data[i * 2 + 0];
-        const int k = data[i * 2 + 1];
-        chunk_t* chunk = terrain_get(&terrain, j, k);
-        memset(chunk->blocks, 0, sizeof(chunk->blocks));
-        chunk->skip = true;
-        chunk->load = true;
-        chunk->mesh = true;
+        const int j = terrain_index(&terrain, data[i * 2 + 0], data[i * 2 + 1]);
+        chunk_clear(&terrain.chunks[j]);
+        terrain.skips[j] = true;
+        terrain.loads[j] = true;
+        terrain.meshes[j] = CHUNK_DIRTY;
+    }
+    if (x1 == INT_MAX)
+    {
+        return;
+    }
+    for (int i = 0; i < width; i++)
+    for (int j = 0; j < depth; j++)
+    {
+        if (!terrain_border(&terrain, i, j) || !contains(x1, z1, width1, depth1, a + i, c + j))
+        {
+            continue;
+        }
+        for (direction_t d = 0; d < DIRECTION_2; d++)
+        {
+            const int s = a + i + directions[d][0];
+            const int t = c + j + directions[d][2];
+            if (contains(x1, z1, width1, depth1, s, t) && !terrain_in2(&terrain, s, t))
+            {
+                terrain.meshes[terrain_index(&terrain, i, j)] = CHUNK_DIRTY;
+                break;
+            }
+        }
+    }
+}
+
+static void move_lods(
+    const int x,
+    const int z)
+{
+    for (int level = 1; level <= WORLD_LODS; level++)
+    {
+        const int a = (x >> (CHUNK_X_BITS + level)) - WORLD_X / 2;
+        const int c = (z >> (CHUNK_Z_BITS + level)) - WORLD_Z / 2;
+        windows[level][0] = a;
+        windows[level][1] = c;
+        for (int i = 0; i < WORLD_X; i++)
+        for (int j = 0; j < WORLD_Z; j++)
+        {
+            lod_t* lod = get_lod(level, a + i, c + j);
+            if (lod->x != a + i || lod->z != c + j)
+            {
+                lod->x = a + i;
+                lod->z = c + j;
+                lod->loads = true;
+                lod->size = 0;
+            }
+        }
     }
-    free(data);
+}
+
+static bool ready(
+    const int x,
+    const int z)
+{
+    int neighbors[DIRECTION_2];
+    terrain_neighbors(&terrain, x, z, neighbors);
+    for (direction_t direction = 0; direction < DIRECTION_2; direction++)
+    {
+        const int neighbor = neighbors[direction];
+        if (neighbor >= 0 && terrain.loads[neighbor])
+        {
+            return false;
+        }
+    }
+    int corners[DIAGONAL_COUNT];
+    terrain_diagonals(&terrain, x, z, corners);
+    for (diagonal_t diagonal = 0; diagonal < DIAGONAL_COUNT; diagonal++)
+    {
+        const int neighbor = corners[diagonal];
+        if (neighbor >= 0 && terrain.loads[neighbor])
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 void world_update(
@@ -247,14 +893,46 @@ void world_update(
     const int z)
 {
     move(x, y, z);
+    move_lods(x, z);
+    for (int i = 0; i < edit_count; i++)
+    {
+        const int j = edits[i][0] - terrain.x;
+        const int k = edits[i][1] - terrain.z;
+        if (!terrain_in(&terrain, j, k))
+        {
+            continue;
+        }
+        const int index = terrain_index(&terrain, j, k);
+        if (terrain.skips[index] || terrain.loads[index] ||
+            !terrain.meshes[index] || terrain.meshes[index] == CHUNK_DIRTY || !ready(j, k))
+        {
+            continue;
+        }
+        mesh(&editor, j, k);
+    }
+    edit_count = 0;
     int n = 0;
     job_t jobs[WORLD_WORKERS];
-    for (int i = 0; i < WORLD_CHUNKS && n < WORLD_WORKERS; i++)
+    const int a = terrain.x + terrain.width / 2;
+    const int c = terrain.z + terrain.depth / 2;
+    if (!pruned || abs(a - prune_x) > DATABASE_MESH_DISTANCE / 2 ||
+        abs(c - prune_z) > DATABASE_MESH_DISTANCE / 2)
+    {
+        job_t* job = &jobs[n++];
+        job->type = JOB_TYPE_PRUNE;
+        job->x = a;
+        job->z = c;
+        prune_x = a;
+        prune_z = c;
+        pruned = true;
+    }
+    const int count = terrain.width * terrain.depth;
+    for (int i = 0; i < count && n < WORLD_WORKERS; i++)
     {
         const int j = sorted[i][0];
         const int k = sorted[i][1];
-        chunk_t* chunk = terrain_get(&terrain, j, k);
-        if (chunk->load)
+        const int index = terrain_index(&terrain, j, k);
+        if (terrain.loads[index])
         {
             job_t* job = &jobs[n++];
             job->type = JOB_TYPE_LOAD;
@@ -262,23 +940,11 @@ void world_update(
             job->z = k;
             continue;
         }
-        if (chunk->skip || !chunk->mesh || terrain_border(&terrain, j, k))
+        if (terrain.skips[index] || !terrain.meshes[index])
         {
             continue;
         }
-        bool status = true;
-        chunk_t* neighbors[DIRECTION_2];
-        terrain_neighbors(&terrain, j, k, neighbors);
-        for (direction_t direction = 0; direction < DIRECTION_2; direction++)
-        {
-            const chunk_t* neighbor = neighbors[direction];
-            if (!neighbor || neighbor->load)
-            {
-                status = false;
-                break;
-            }
-        }
-        if (status)
+        if (ready(j, k))
         {
             job_t* job = &jobs[n++];
             job->type = JOB_TYPE_MESH;
@@ -287,7 +953,22 @@ void world_update(
             continue;
         }
     }
-    uint32_t size = 0;
+    for (int level = 1; level <= WORLD_LODS && n < WORLD_WORKERS; level++)
+    for (int i = 0; i < WORLD_CHUNKS && n < WORLD_WORKERS; i++)
+    {
+        const int j = windows[level][0] + lod_sorted[i][0];
+        const int k = windows[level][1] + lod_sorted[i][1];
+        if (!get_lod(level, j, k)->loads || is_hidden(level, j, k))
+        {
+            continue;
+        }
+        job_t* job = &jobs[n++];
+        job->type = JOB_TYPE_LOD;
+        job->x = j;
+        job->z = k;
+        job->level = level;
+    }
+    busy = n > 0;
     for (int i = 0; i < n; i++)
     {
         dispatch(&workers[i], &jobs[i]);
@@ -299,84 +980,297 @@ void world_update(
     for (int i = 0; i < n; i++)
     {
         const job_t* job = &jobs[i];
-        if (job->type != JOB_TYPE_MESH)
+        if (job->type == JOB_TYPE_LOAD)
         {
-            continue;
-        }
-        chunk_t* chunk = terrain_get(&terrain, job->x, job->z);
-        for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
-        {
-            size = max(size, chunk->sizes[mesh]);
+            int neighbors[DIRECTION_2];
+            terrain_neighbors(&terrain, job->x, job->z, neighbors);
+            for (direction_t direction = 0; direction < DIRECTION_2; direction++)
+            {
+                if (neighbors[direction] >= 0)
+                {
+                    terrain.meshes[neighbors[direction]] = CHUNK_DIRTY;
+                }
+            }
+            int corners[DIAGONAL_COUNT];
+            terrain_diagonals(&terrain, job->x, job->z, corners);
+            for (diagonal_t diagonal = 0; diagonal < DIAGONAL_COUNT; diagonal++)
+            {
+                if (corners[diagonal] >= 0)
+                {
+                    terrain.meshes[corners[diagonal]] = CHUNK_DIRTY;
+                }
+            }
         }
     }
-    if (size > ibo_size)
+    if (exhausted)
     {
-        if (ibo)
+        full = !grow();
+        exhausted = false;
+    }
+}
+
+#if !VOXEL_COMPUTE
+static void get_visibles(
+    const camera_t* camera,
+    const int x,
+    const int y,
+    const int z,
+    const chunk_mesh_t mesh,
+    bool visibles[CHUNK_BUCKETS])
+{
+    if (!camera || mesh != CHUNK_MESH_OPAQUE)
+    {
+        for (int bucket = 0; bucket < CHUNK_BUCKETS; bucket++)
         {
-            SDL_ReleaseGPUBuffer(device, ibo);
-            ibo = NULL;
-            ibo_size = 0;
+            visibles[bucket] = true;
         }
-        if (voxel_ibo(device, &ibo, size))
+        return;
+    }
+    visibles[DIRECTION_N] = camera->z > z;
+    visibles[DIRECTION_S] = camera->z < z + CHUNK_Z;
+    visibles[DIRECTION_E] = camera->x > x;
+    visibles[DIRECTION_W] = camera->x < x + CHUNK_X;
+    visibles[DIRECTION_U] = camera->y > y;
+    visibles[DIRECTION_D] = camera->y < y + SECTION_Y;
+    visibles[CHUNK_BUCKET_SPRITE] = true;
+}
+
+static void add_draw(
+    SDL_GPUIndirectDrawCommand* data,
+    uint32_t* size,
+    const chunk_mesh_t mesh,
+    const uint32_t count,
+    const uint32_t first)
+{
+    assert(*size < terrain.count * CHUNK_SECTIONS * CHUNK_BUCKETS);
+    SDL_GPUIndirectDrawCommand* draw = &data[(*size)++];
+    draw->num_vertices = mesh == CHUNK_MESH_SPRITE ? 24 : 6;
+    draw->num_instances = count;
+    draw->first_vertex = 0;
+    draw->first_instance = first;
+}
+#endif
+
+void world_prepare(
+    const camera_t* camera,
+    SDL_GPUCommandBuffer* commands)
+{
+    assert(camera);
+    assert(commands);
+    memset(counts, 0, sizeof(counts));
+#if VOXEL_COMPUTE
+    SDL_GPUCopyPass* pass = SDL_BeginGPUCopyPass(commands);
+    if (!pass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        return;
+    }
+#else
+    SDL_GPUIndirectDrawCommand* data = SDL_MapGPUTransferBuffer(device, draw_tbo, true);
+    if (!data)
+    {
+        SDL_Log("Failed to map tbo buffer: %s", SDL_GetError());
+        return;
+    }
+#endif
+    uint32_t size = 0;
+    const int count = terrain.width * terrain.depth;
+    for (chunk_mesh_t mesh = 0; mesh < CHUNK_MESH_COUNT; mesh++)
+    {
+        const camera_t* view = mesh != CHUNK_MESH_SHADOW ? camera : NULL;
+        firsts[mesh] = size;
+        for (int i = 0; i < count; i++)
         {
-            ibo_size = size;
+            int x;
+            int z;
+            if (mesh != CHUNK_MESH_TRANSPARENT)
+            {
+                x = sorted[i][0];
+                z = sorted[i][1];
+            }
+            else
+            {
+                x = sorted[count - i - 1][0];
+                z = sorted[count - i - 1][1];
+            }
+            const int j = terrain_index(&terrain, x, z);
+            if (terrain.skips[j] || terrain.meshes[j])
+            {
+                continue;
+            }
+            x = (x + terrain.x) * CHUNK_X;
+            z = (z + terrain.z) * CHUNK_Z;
+            const int y = terrain.lows[j];
+            const int height = terrain.highs[j] - terrain.lows[j];
+            if (view && !camera_test(view, x, y, z, CHUNK_X, height, CHUNK_Z))
+            {
+                continue;
+            }
+#if VOXEL_COMPUTE
+            SDL_GPUBufferLocation src = {0};
+            src.buffer = terrain.indirects[j];
+            src.offset = mesh * sizeof(SDL_GPUIndirectDrawCommand);
+            SDL_GPUBufferLocation dst = {0};
+            dst.buffer = draws;
+            dst.offset = size * sizeof(SDL_GPUIndirectDrawCommand);
+            SDL_CopyGPUBufferToBuffer(pass, &src, &dst, sizeof(SDL_GPUIndirectDrawCommand), size == 0);
+            size++;
+#else
+            for (int k = y / SECTION_Y; k * SECTION_Y < terrain.highs[j]; k++)
+            {
+                if (!terrain.sizes[j][k][mesh])
+                {
+                    continue;
+                }
+                if (view && !camera_test(view, x, k * SECTION_Y, z, CHUNK_X, SECTION_Y, CHUNK_Z))
+                {
+                    continue;
+                }
+                bool visibles[CHUNK_BUCKETS];
+                get_visibles(view, x, k * SECTION_Y, z, mesh, visibles);
+                const uint16_t* buckets = terrain.buckets[j][k][mesh];
+                const uint32_t base = terrain.offsets[j][k][mesh];
+                uint32_t offset = 0;
+                uint32_t first = 0;
+                uint32_t instances = 0;
+                for (int bucket = 0; bucket < CHUNK_BUCKETS; bucket++)
+                {
+                    if (!buckets[bucket])
+                    {
+                        continue;
+                    }
+                    if (visibles[bucket])
+                    {
+                        first = instances ? first : offset;
+                        instances += buckets[bucket];
+                    }
+                    else if (instances)
+                    {
+                        add_draw(data, &size, mesh, instances, base + first);
+                        instances = 0;
+                    }
+                    offset += buckets[bucket];
+                }
+                if (instances)
+                {
+                    add_draw(data, &size, mesh, instances, base + first);
+                }
+            }
+#endif
         }
+        counts[mesh] = size - firsts[mesh];
+    }
+#if VOXEL_COMPUTE
+    SDL_EndGPUCopyPass(pass);
+#else
+    SDL_UnmapGPUTransferBuffer(device, draw_tbo);
+    if (!size)
+    {
+        return;
+    }
+    SDL_GPUCopyPass* pass = SDL_BeginGPUCopyPass(commands);
+    if (!pass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        memset(counts, 0, sizeof(counts));
+        return;
     }
+    SDL_GPUTransferBufferLocation location = {0};
+    location.transfer_buffer = draw_tbo;
+    SDL_GPUBufferRegion region = {0};
+    region.buffer = draws;
+    region.size = size * sizeof(SDL_GPUIndirectDrawCommand);
+    SDL_UploadToGPUBuffer(pass, &location, &region, true);
+    SDL_EndGPUCopyPass(pass);
+#endif
 }
 
 void world_render(
-    const camera_t* camera,
-    SDL_GPUCommandBuffer* commands,
     SDL_GPURenderPass* pass,
     const chunk_mesh_t mesh)
 {
-    assert(commands);
     assert(pass);
-    if (!ibo)
+    if (!counts[mesh])
     {
         return;
     }
-    SDL_GPUBufferBinding ibb = {0};
-    ibb.buffer = ibo;
-    SDL_BindGPUIndexBuffer(pass, &ibb, SDL_GPU_INDEXELEMENTSIZE_32BIT);
-    for (int i = 0; i < WORLD_CHUNKS; i++)
+    SDL_GPUBufferBinding vbb = {0};
+    vbb.buffer = vbo;
+    SDL_BindGPUVertexBuffers(pass, 0, &vbb, 1);
+    SDL_BindGPUVertexStorageBuffers(pass, 0, &pages, 1);
+    SDL_DrawGPUPrimitivesIndirect(pass, draws, firsts[mesh] * sizeof(SDL_GPUIndirectDrawCommand), counts[mesh]);
+}
+
+void world_render_lods(
+    const camera_t* camera,
+    SDL_GPUCommandBuffer* commands,
+    SDL_GPURenderPass* pass)
+{
+    assert(commands);
+    assert(pass);
+    for (int level = 1; level <= WORLD_LODS; level++)
     {
-        int x;
-        int z;
-        if (mesh == CHUNK_MESH_OPAQUE)
+        int inner[4];
+        get_inner(level, inner);
+        const float bounds[4] = { inner[0], inner[1], inner[2], inner[3] };
+        const int32_t scale = 1 << level;
+        const int width = CHUNK_X << level;
+        const int depth = CHUNK_Z << level;
+        SDL_PushGPUVertexUniformData(commands, 3, &scale, sizeof(scale));
+        SDL_PushGPUFragmentUniformData(commands, 0, bounds, sizeof(bounds));
+        for (int i = 0; i < WORLD_CHUNKS; i++)
         {
-            x = sorted[i][0] + terrain.x;
-            z = sorted[i][1] + terrain.z;
-        }
-        else
-        {
-            x = sorted[WORLD_CHUNKS - i - 1][0] + terrain.x;
-            z = sorted[WORLD_CHUNKS - i - 1][1] + terrain.z;
-        }
-        const chunk_t* chunk = terrain_get2(&terrain, x, z);
-        if (terrain_border2(&terrain, x, z)) 
-        {
-            continue;
-        }
-        if (chunk->skip || chunk->mesh || !chunk->sizes[mesh])
-        {
-            continue;
+            const int x = windows[level][0] + lod_sorted[i][0];
+            const int z = windows[level][1] + lod_sorted[i][1];
+            const lod_t* lod = get_lod(level, x, z);
+            if (lod->loads || !lod->size || is_hidden(level, x, z))
+            {
+                continue;
+            }
+            if (camera && !camera_test(camera, x * width, 0, z * depth, width, lod->high, depth))
+            {
+                continue;
+            }
+            int32_t position[3] = { x * width, 0, z * depth };
+            SDL_PushGPUVertexUniformData(commands, 0, position, sizeof(position));
+            SDL_GPUBufferBinding vbb = {0};
+            vbb.buffer = lod->vbo;
+            SDL_BindGPUVertexBuffers(pass, 0, &vbb, 1);
+            SDL_DrawGPUPrimitives(pass, 6, lod->size, 0, 0);
         }
-        assert(chunk->sizes[mesh] <= ibo_size);
-        x *= CHUNK_X;
-        z *= CHUNK_Z;
-        if (camera && !camera_test(camera, x, 0, z, CHUNK_X, CHUNK_Y, CHUNK_Z))
+    }
+}
+
+static void edit(
+    const int x,
+    const int z)
+{
+    for (int i = 0; i < edit_count; i++)
+    {
+        if (edits[i][0] == x && edits[i][1] == z)
         {
-            continue;
+            return;
         }
-        int32_t position[3] = { x, 0, z };
-        SDL_GPUBufferBinding vbb = {0};
-        vbb.buffer = chunk->vbos[mesh];
-        SDL_PushGPUVertexUniformData(commands, 0, position, sizeof(position));
-        SDL_BindGPUVertexBuffers(pass, 0, &vbb, 1);
-        SDL_DrawGPUIndexedPrimitives(pass, chunk->sizes[mesh] * 6, 1, 0, 0, 0);
+    }
+    if (edit_count < WORLD_EDITS)
+    {
+        edits[edit_count][0] = x;
+        edits[edit_count][1] = z;
+        edit_count++;
+    }
+}
 
+static void invalidate(
+    const int x,
+    const int z,
+    const uint32_t sections)
+{
+    if (!terrain_in2(&terrain, x, z))
+    {
+        return;
     }
+    terrain.meshes[terrain_index2(&terrain, x, z)] |= sections;
+    edit(x, z);
 }
 
 void world_set_block(
@@ -385,34 +1279,61 @@ void world_set_block(
     int z,
     const block_t block)
 {
-    const int a = floor((float) x / CHUNK_X);
-    const int c = floor((float) z / CHUNK_Z);
+    const int a = x >> CHUNK_X_BITS;
+    const int c = z >> CHUNK_Z_BITS;
     if (!terrain_in2(&terrain, a, c) || y < 0 || y >= CHUNK_Y)
     {
         return;
     }
     chunk_wrap(&x, &y, &z);
-    chunk_t* chunk = terrain_get2(&terrain, a, c);
+    const int i = terrain_index2(&terrain, a, c);
+    chunk_t* chunk = &terrain.chunks[i];
     database_set_block(a, c, x, y, z, block);
     chunk_set_block(chunk, x, y, z, block);
-    chunk->mesh = true;
-    chunk_t* neighbors[DIRECTION_2];
-    terrain_neighbors2(&terrain, a, c, neighbors);
-    if (x == 0 && neighbors[DIRECTION_W])
+    terrain.lows[i] = chunk->low;
+    terrain.highs[i] = chunk->high;
+    terrain.skips[i] = false;
+    const int section = y / SECTION_Y;
+    uint32_t sections = 1u << section;
+    if (y % SECTION_Y == 0 && section > 0)
+    {
+        sections |= 1u << (section - 1);
+    }
+    else if (y % SECTION_Y == SECTION_Y - 1 && section < CHUNK_SECTIONS - 1)
     {
-        neighbors[DIRECTION_W]->mesh = true;
+        sections |= 1u << (section + 1);
     }
-    else if (x == CHUNK_X - 1 && neighbors[DIRECTION_E])
+    terrain.meshes[i] |= sections;
+    edit(a, c);
+    int dx = 0;
+    int dz = 0;
+    if (x == 0)
     {
-        neighbors[DIRECTION_E]->mesh = true;
+        dx = -1;
     }
-    if (z == 0 && neighbors[DIRECTION_S])
+    else if (x == CHUNK_X - 1)
     {
-        neighbors[DIRECTION_S]->mesh = true;
+        dx = 1;
     }
-    else if (z == CHUNK_Z - 1 && neighbors[DIRECTION_N])
+    if (z == 0)
     {
-        neighbors[DIRECTION_N]->mesh = true;
+        dz = -1;
+    }
+    else if (z == CHUNK_Z - 1)
+    {
+        dz = 1;
+    }
+    if (dx)
+    {
+        invalidate(a + dx, c, sections);
+    }
+    if (dz)
+    {
+        invalidate(a, c + dz, sections);
+    }
+    if (dx && dz)
+    {
+        invalidate(a + dx, c + dz, sections);
     }
 }
 
@@ -421,20 +1342,87 @@ block_t world_get_block(
     int y,
     int z)
 {
-    const int a = floor((float) x / CHUNK_X);
-    const int c = floor((float) z / CHUNK_Z);
+    const int a = x >> CHUNK_X_BITS;
+    const int c = z >> CHUNK_Z_BITS;
     if (!terrain_in2(&terrain, a, c) || y < 0 || y >= CHUNK_Y)
     {
         return BLOCK_EMPTY;
     }
     chunk_wrap(&x, &y, &z);
-    const chunk_t* chunk = terrain_get2(&terrain, a, c);
-    if (!chunk->load)
+    const int i = terrain_index2(&terrain, a, c);
+    const chunk_t* chunk = &terrain.chunks[i];
+    if (terrain.loads[i] || y < chunk->lows[x][z] || y >= chunk->highs[x][z])
     {
-        return chunk_get_block(chunk, x, y, z);
+        return BLOCK_EMPTY;
     }
     else
     {
-        return BLOCK_EMPTY;
+        return chunk_get_block(chunk, x, y, z);
+    }
+}
+
+bool world_get_mask(
+    int x,
+    int y,
+    int z,
+    const chunk_mask_t mask)
+{
+    const int a = x >> CHUNK_X_BITS;
+    const int c = z >> CHUNK_Z_BITS;
+    if (!terrain_in2(&terrain, a, c) || y < 0 || y >= CHUNK_Y)
+    {
+        return false;
     }
-}
\ No newline at end of file
+    chunk_wrap(&x, &y, &z);
+    const int i = terrain_index2(&terrain, a, c);
+    const chunk_t* chunk = &terrain.chunks[i];
+    if (terrain.loads[i] || y < chunk->lows[x][z] || y >= chunk->highs[x][z])
+    {
+        return false;
+    }
+    return chunk_get_mask(chunk, mask, y, z) >> x & 1;
+}
+
+void world_set_distance(
+    const int value)
+{
+    distance = clamp(value, WORLD_DISTANCE_MIN, maximum);
+    limit = distance;
+    grown = false;
+}
+
+int world_get_distance()
+{
+    return distance;
+}
+
+void world_adapt(
+    const float dt)
+{
+    if (busy)
+    {
+        elapsed = 0.0f;
+        return;
+    }
+    average += (dt - average) * 0.05f;
+    elapsed += dt;
+    if (elapsed < WORLD_COOLDOWN)
+    {
+        return;
+    }
+    elapsed = 0.0f;
+    if (average > WORLD_BUDGET && distance > WORLD_DISTANCE_MIN)
+    {
+        distance--;
+        if (grown)
+        {
+            limit = distance;
+        }
+        grown = false;
+    }
+    else if (average < WORLD_BUDGET * 0.75f && distance < limit)
+    {
+        distance++;
+        grown = true;
+    }
+}
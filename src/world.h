@@ -7,17 +7,23 @@
 #include "chunk.h"
 
 bool world_init(
-    SDL_GPUDevice* device);
+    SDL_GPUDevice* device,
+    const int distance);
 void world_free();
 void world_update(
     const int x,
     const int y,
     const int z);
-void world_render(
+void world_prepare(
     const camera_t* camera,
-    SDL_GPUCommandBuffer* commands,
+    SDL_GPUCommandBuffer* commands);
+void world_render(
     SDL_GPURenderPass* pass,
     const chunk_mesh_t mesh);
+void world_render_lods(
+    const camera_t* camera,
+    SDL_GPUCommandBuffer* commands,
+    SDL_GPURenderPass* pass);
 void world_set_block(
     int x,
     int y,
@@ -26,4 +32,14 @@ void world_set_block(
 block_t world_get_block(
     int x,
     int y,
-    int z);
\ No newline at end of file
+    int z);
+bool world_get_mask(
+    int x,
+    int y,
+    int z,
+    const chunk_mask_t mask);
+void world_set_distance(
+    const int distance);
+int world_get_distance();
+void world_adapt(
+    const float dt);
\ No newline at end of file